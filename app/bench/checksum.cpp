@@ -0,0 +1,188 @@
+/*
+ * checksum.cpp
+ *
+ * Verifies that every NetworkUtil::one_sum kernel matches the bytewise
+ * reference and reports the throughput of each, and compares
+ * NetworkUtil::copy_and_sum with a copy followed by one_sum.
+ *
+ * The kernels live in libe, which CMake builds with -O0, so the absolute
+ * numbers (and whether fusing pays off at all) depend on how libe was
+ * built. Neither copy variant is expected to win by a fixed margin.
+ *
+ * usage: bench-checksum [size ...]
+ */
+
+#include <E/Networking/E_NetworkUtil.hpp>
+#include <E/Networking/E_Packet.hpp>
+#include <chrono>
+
+using namespace E;
+using SumKernel = NetworkUtil::SumKernel;
+
+static const std::vector<std::pair<SumKernel, const char *>> kernels = {
+    {SumKernel::BYTEWISE, "bytewise"},
+    {SumKernel::WORD64, "word64"},
+    {SumKernel::SSE2, "sse2"},
+    {SumKernel::AVX2, "avx2"},
+};
+
+static bool verifyCopy(std::mt19937 &rng, const std::vector<uint8_t> &buffer) {
+  std::vector<uint8_t> copy(buffer.size());
+  for (int k = 0; k < 1000; k++) {
+    size_t offset = rng() % 64;
+    size_t size = rng() % (k < 500 ? 300 : buffer.size() - 64);
+    std::fill(copy.begin(), copy.end(), 0);
+    uint16_t sum =
+        NetworkUtil::copy_and_sum(copy.data(), &buffer[offset], size);
+    if (sum != NetworkUtil::one_sum(&buffer[offset], size) ||
+        memcmp(copy.data(), &buffer[offset], size) != 0) {
+      printf("MISMATCH copy_and_sum offset %zu size %zu\n", offset, size);
+      return false;
+    }
+  }
+
+  // A TCP segment written in odd-sized chunks, folded at the end.
+  const uint32_t source = 0x0100000A, dest = 0x0200000A;
+  for (size_t payload = 0; payload < 3000; payload += 1 + rng() % 97) {
+    size_t tcp_start = 14 + 20, header = 20;
+    Packet packet(tcp_start + header + payload);
+    packet.writeData(tcp_start, buffer.data(), header);
+    uint16_t sum = 0;
+    for (size_t done = 0; done < payload;) {
+      size_t chunk = std::min<size_t>(payload - done, 1 + rng() % 700);
+      packet.writeDataAndSum(tcp_start + header + done, &buffer[header + done],
+                             chunk, sum);
+      done += chunk;
+    }
+    uint16_t fused =
+        NetworkUtil::tcp_sum(source, dest, buffer.data(), header, sum, payload);
+    if (fused != NetworkUtil::tcp_sum(source, dest, buffer.data(),
+                                      header + payload)) {
+      printf("MISMATCH fused tcp_sum payload %zu\n", payload);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool verify(std::mt19937 &rng) {
+  std::vector<uint8_t> buffer(70000);
+  for (auto &byte : buffer)
+    byte = rng();
+
+  // Odd sizes and unaligned starts, plus all-zero and all-0xFF data.
+  std::vector<std::pair<size_t, size_t>> ranges;
+  for (size_t size = 0; size < 300; size++)
+    ranges.push_back({size % 7, size});
+  for (int k = 0; k < 1000; k++)
+    ranges.push_back({rng() % 64, rng() % (buffer.size() - 64)});
+  ranges.push_back({0, buffer.size()});
+
+  std::vector<uint8_t> zeros(4096, 0), ones(4096, 0xFF);
+  for (const auto &[name, data] :
+       {std::make_pair("zero", &zeros), std::make_pair("ones", &ones)}) {
+    for (const auto &[kernel, kernel_name] : kernels) {
+      if (!NetworkUtil::has_sum_kernel(kernel))
+        continue;
+      if (NetworkUtil::one_sum(data->data(), data->size(), kernel) !=
+          NetworkUtil::one_sum(data->data(), data->size(),
+                               SumKernel::BYTEWISE)) {
+        printf("MISMATCH %s on %s data\n", kernel_name, name);
+        return false;
+      }
+    }
+  }
+
+  for (const auto &[offset, size] : ranges) {
+    uint16_t expected =
+        NetworkUtil::one_sum(&buffer[offset], size, SumKernel::BYTEWISE);
+    for (const auto &[kernel, name] : kernels) {
+      if (!NetworkUtil::has_sum_kernel(kernel))
+        continue;
+      if (NetworkUtil::one_sum(&buffer[offset], size, kernel) != expected) {
+        printf("MISMATCH %s offset %zu size %zu\n", name, offset, size);
+        return false;
+      }
+    }
+  }
+  return verifyCopy(rng, buffer);
+}
+
+static void measure(std::mt19937 &rng, size_t size) {
+  std::vector<uint8_t> buffer(size);
+  for (auto &byte : buffer)
+    byte = rng();
+
+  // Roughly 256 MiB of input per kernel.
+  size_t rounds =
+      std::max<size_t>(1, (256UL << 20) / std::max<size_t>(size, 1));
+  printf("size %8zu:", size);
+  for (const auto &[kernel, name] : kernels) {
+    if (!NetworkUtil::has_sum_kernel(kernel))
+      continue;
+    uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < rounds; k++)
+      sink += NetworkUtil::one_sum(buffer.data(), size, kernel);
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("  %s %8.1f MB/s", name, (double)size * rounds / seconds / 1e6);
+    if (sink == 1)
+      printf(" ");
+  }
+  printf("\n");
+}
+
+static void measureCopy(std::mt19937 &rng, size_t size) {
+  std::vector<uint8_t> source(size), destination(size);
+  for (auto &byte : source)
+    byte = rng();
+
+  // Alternate the two variants in short trials and keep the best of each,
+  // so that frequency changes and noise hit both alike.
+  const int trials = 8;
+  size_t rounds =
+      std::max<size_t>(1, (32UL << 20) / std::max<size_t>(size, 1));
+  uint32_t sink = 0;
+  double separate = 0, fused = 0;
+  for (int trial = 0; trial < trials; trial++) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < rounds; k++) {
+      memcpy(destination.data(), source.data(), size);
+      sink += NetworkUtil::one_sum(destination.data(), size);
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < rounds; k++)
+      sink +=
+          NetworkUtil::copy_and_sum(destination.data(), source.data(), size);
+    auto end = std::chrono::steady_clock::now();
+
+    double bytes = (double)size * rounds;
+    separate = std::max(
+        separate,
+        bytes / std::chrono::duration<double>(middle - start).count());
+    fused = std::max(
+        fused, bytes / std::chrono::duration<double>(end - middle).count());
+  }
+  printf("copy %8zu:  copy+sum %8.1f MB/s  copy_and_sum %8.1f MB/s%s\n", size,
+         separate / 1e6, fused / 1e6, sink == 1 ? " " : "");
+}
+
+int main(int argc, char *argv[]) {
+  std::mt19937 rng(12345);
+  if (!verify(rng))
+    return 1;
+  printf("all kernels match the bytewise reference\n");
+
+  std::vector<size_t> sizes = {20, 64, 576, 1500, 9000, 65536};
+  if (argc > 1) {
+    sizes.clear();
+    for (int k = 1; k < argc; k++)
+      sizes.push_back(strtoul(argv[k], nullptr, 10));
+  }
+  for (size_t size : sizes)
+    measure(rng, size);
+  for (size_t size : sizes)
+    measureCopy(rng, size);
+  return 0;
+}
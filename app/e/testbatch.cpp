@@ -0,0 +1,183 @@
+/*
+ * testbatch.cpp
+ */
+
+#include <E/E_Common.hpp>
+#include <E/Networking/E_Host.hpp>
+#include <E/Networking/E_Networking.hpp>
+#include <E/Networking/E_Packet.hpp>
+#include <E/Networking/E_Switch.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace E;
+
+static constexpr mac_t RECEIVER_MAC = {0, 1, 2, 3, 4, 5};
+static constexpr size_t FRAME_SIZE = 14 + 20 + 20 + 4 + 4;
+static constexpr size_t SEQUENCE = 14 + 20 + 20 + 4; // after what a drop hits
+
+static mac_t senderMAC(uint8_t id) { return {2, 0, 0, 0, 0, id}; }
+
+// Sends a burst of numbered frames to the receiver when it is initialized.
+class BurstSender : public HostModule {
+public:
+  BurstSender(Host &host, uint8_t id, size_t count)
+      : HostModule("Sender", host), id(id), count(count) {}
+
+  virtual void initialize() final {
+    for (uint32_t k = 0; k < count; k++) {
+      Packet frame(FRAME_SIZE);
+      frame.writeData(0, RECEIVER_MAC.data(), RECEIVER_MAC.size());
+      mac_t source = senderMAC(id);
+      frame.writeData(6, source.data(), source.size());
+      uint32_t sequence = (id << 24) | k;
+      frame.writeData(SEQUENCE, &sequence, sizeof(sequence));
+      sendPacket("Host", std::move(frame));
+    }
+  }
+
+protected:
+  uint8_t id;
+  size_t count;
+
+  virtual void packetArrived(std::string fromModule, Packet &&packet) final {
+    (void)fromModule;
+    (void)packet;
+  }
+};
+
+// Records every frame the receiving Host gets.
+class FrameSink : public HostModule {
+public:
+  class Arrival {
+  public:
+    Time time;
+    uint32_t sequence;
+    bool corrupted;
+    bool operator==(const Arrival &other) const {
+      return time == other.time && sequence == other.sequence &&
+             corrupted == other.corrupted;
+    }
+  };
+
+  FrameSink(Host &host, std::vector<Arrival> &arrivals)
+      : HostModule("Ethernet", host), arrivals(arrivals) {}
+
+protected:
+  std::vector<Arrival> &arrivals;
+
+  virtual void packetArrived(std::string fromModule, Packet &&packet) final {
+    (void)fromModule;
+    uint32_t sequence, data;
+    packet.readData(SEQUENCE, &sequence, sizeof(sequence));
+    packet.readData(SEQUENCE - 4, &data, sizeof(data));
+    arrivals.push_back({packet.getMetadata().ingressTime, sequence,
+                        data == 0xEEEEEEEE || data == 0xEEEEEEEF});
+  }
+};
+
+// Counts the batches of more than one packet it processes.
+class CountingSwitch : public Switch {
+public:
+  CountingSwitch(std::string name, NetworkSystem &system)
+      : Switch(name, system) {}
+  size_t batches = 0;
+
+protected:
+  virtual void packetsArrived(const ModuleID inWireID,
+                              PacketBatch &&batch) final {
+    batches += batch.size() > 1;
+    Switch::packetsArrived(inWireID, std::move(batch));
+  }
+};
+
+class Outcome {
+public:
+  std::vector<FrameSink::Arrival> arrivals;
+  std::string firstCapture;
+  std::string secondCapture;
+  size_t batches = 0;
+};
+
+static std::string readFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  std::remove(path.c_str());
+  return content.str();
+}
+
+// Four senders share the unreliable first Switch, whose queue overflows.
+// Both Switches have no transmission delay and the Wires do not limit
+// speed, so simultaneous frames travel together.
+static Outcome fanIn(bool batching) {
+  Outcome outcome;
+  std::string first = ::testing::TempDir() + "fanin-first.pcap";
+  std::string second = ::testing::TempDir() + "fanin-second.pcap";
+  std::srand(35); // seeds the drop decisions of the Switch
+  {
+    NetworkSystem system;
+    auto firstSwitch = system.addModule<Switch>("First", system, true);
+    auto secondSwitch = system.addModule<CountingSwitch>("Second", system);
+    auto receiver = system.addModule<Host>("Receiver", system);
+    std::vector<std::shared_ptr<Host>> senders;
+    for (uint8_t id = 0; id < 4; id++) {
+      senders.push_back(
+          system.addModule<Host>("Sender" + std::to_string(id), system));
+      auto port = system.addWire(*senders.back(), *firstSwitch, 1000,
+                                 1000000000UL, false)
+                      .second;
+      senders.back()->setMACAddr(senderMAC(id), port.first);
+    }
+    auto middle =
+        system.addWire(*firstSwitch, *secondSwitch, 1000, 1000000000UL, false)
+            .second;
+    auto last =
+        system.addWire(*secondSwitch, *receiver, 1000, 1000000000UL, false)
+            .second;
+    firstSwitch->addMACEntry(middle.first, RECEIVER_MAC);
+    secondSwitch->addMACEntry(last.first, RECEIVER_MAC);
+
+    for (Switch *link : {firstSwitch.get(), (Switch *)secondSwitch.get()}) {
+      link->setLinkSpeed(0);
+      link->setBatching(batching);
+    }
+    firstSwitch->setQueueSize(48);
+    firstSwitch->enablePCAPLogging(first);
+    secondSwitch->enablePCAPLogging(second);
+
+    receiver->addHostModule<FrameSink>(*receiver, outcome.arrivals);
+    for (uint8_t id = 0; id < 4; id++) {
+      senders[id]->addHostModule<BurstSender>(*senders[id], id, 10 + 10 * id);
+      senders[id]->initializeHostModule("Sender");
+    }
+    system.run(0);
+    outcome.batches = secondSwitch->batches;
+    senders.clear();
+    receiver.reset();
+    firstSwitch.reset();
+    secondSwitch.reset();
+  }
+  outcome.firstCapture = readFile(first);
+  outcome.secondCapture = readFile(second);
+  return outcome;
+}
+
+TEST(Batch, FanInMatchesPerPacketPath) {
+  Outcome batched = fanIn(true);
+  Outcome single = fanIn(false);
+
+  EXPECT_GT(batched.batches, 0);
+  EXPECT_EQ(single.batches, 0);
+
+  // 100 frames are sent, and the queue of 48 drops some.
+  EXPECT_GT(batched.arrivals.size(), 0);
+  EXPECT_LT(batched.arrivals.size(), 100);
+  EXPECT_TRUE(std::any_of(batched.arrivals.begin(), batched.arrivals.end(),
+                          [](auto &arrival) { return arrival.corrupted; }));
+
+  EXPECT_TRUE(batched.arrivals == single.arrivals);
+  EXPECT_GT(batched.firstCapture.size(), 24);
+  EXPECT_TRUE(batched.firstCapture == single.firstCapture);
+  EXPECT_TRUE(batched.secondCapture == single.secondCapture);
+}
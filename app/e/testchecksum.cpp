@@ -0,0 +1,244 @@
+/*
+ * testchecksum.cpp
+ */
+
+#include <E/E_Common.hpp>
+#include <E/Networking/E_HeaderView.hpp>
+#include <E/Networking/E_NetworkUtil.hpp>
+#include <E/Networking/E_Packet.hpp>
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+using namespace E;
+
+static constexpr size_t TCP_START = 14 + 20;
+
+static uint32_t toWord(const ipv4_t &ip) {
+  uint32_t word;
+  memcpy(&word, ip.data(), sizeof(word));
+  return word;
+}
+
+static void fillRandom(uint8_t *data, size_t length, std::mt19937 &random) {
+  for (size_t k = 0; k < length; k++)
+    data[k] = random() & 0xFF;
+}
+
+TEST(Checksum, CompleteChecksumsSumsSegmentsInPlace) {
+  std::mt19937 random(1);
+  // Odd segment lengths, so parts start at odd offsets.
+  std::vector<size_t> lengths = {7, 300, 1, 64};
+  size_t payload_length = 0;
+  for (size_t length : lengths)
+    payload_length += length;
+
+  Packet packet(TCP_START + 20);
+  fillRandom(packet.map(TCP_START, 20), 20, random);
+  IPv4HeaderView ip(packet);
+  ip.setVersionAndHeaderLength(4, 5);
+  ip.setTotalLength(20 + 20 + payload_length);
+  ip.setProtocol(6);
+  ip.setSource({10, 0, 0, 1});
+  ip.setDestination({10, 0, 0, 2});
+  for (size_t length : lengths) {
+    PacketBuffer buffer = PacketBuffer::allocate(length, false);
+    fillRandom((uint8_t *)buffer.data(), length, random);
+    packet.appendPayload(buffer, 0, length);
+  }
+  packet.getMetadata().offload =
+      PacketMetadata::IPV4_CHECKSUM | PacketMetadata::TCP_CHECKSUM;
+
+  completeChecksums(packet);
+  EXPECT_EQ(packet.getMetadata().offload, 0);
+  EXPECT_EQ(packet.getSegmentCount(), lengths.size());
+
+  Packet flat = packet.clone();
+  flat.linearize();
+  ConstIPv4HeaderView completed(flat);
+  EXPECT_EQ(NetworkUtil::one_sum(completed.getData(), completed.SIZE), 0xFFFF);
+  size_t tcp_length = 20 + payload_length;
+  EXPECT_EQ(NetworkUtil::tcp_sum(toWord(completed.getSource()),
+                                 toWord(completed.getDestination()),
+                                 flat.peek(TCP_START, tcp_length), tcp_length),
+            0xFFFF);
+}
+
+using Header = std::array<uint8_t, 20>;
+static constexpr size_t CHECKSUM = 10; // offset of the IPv4 checksum
+
+static uint16_t load16(const uint8_t *data) {
+  return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static void store16(uint8_t *data, uint16_t value) {
+  data[0] = value >> 8;
+  data[1] = value & 0xFF;
+}
+
+// Checksum of an IPv4 header, summed from scratch
+static uint16_t recompute(Header header) {
+  store16(&header[CHECKSUM], 0);
+  return ~NetworkUtil::one_sum(header.data(), header.size());
+}
+
+static Header randomHeader(std::mt19937 &random) {
+  Header header;
+  fillRandom(header.data(), header.size(), random);
+  store16(&header[CHECKSUM], recompute(header));
+  return header;
+}
+
+// New values of a word at a 16-bit aligned offset, including the edges
+static uint16_t edgeValue(const Header &header, size_t at, size_t k,
+                          std::mt19937 &random) {
+  switch (k % 4) {
+  case 0:
+    return 0x0000;
+  case 1:
+    return 0xFFFF;
+  case 2: {
+    // The value which makes the recomputed checksum 0x0000
+    Header rest = header;
+    store16(&rest[CHECKSUM], 0);
+    store16(&rest[at], 0);
+    return 0xFFFF - NetworkUtil::one_sum(rest.data(), rest.size());
+  }
+  default:
+    return random() & 0xFFFF;
+  }
+}
+
+TEST(Checksum, UpdateSum16MatchesRecompute) {
+  std::mt19937 random(2);
+  size_t zeros = 0;
+  for (size_t k = 0; k < 10000; k++) {
+    Header header = randomHeader(random);
+    size_t at = 2 * (random() % 10);
+    if (at == CHECKSUM)
+      continue;
+    uint16_t value = edgeValue(header, at, k, random);
+    uint16_t checksum = load16(&header[CHECKSUM]);
+    uint16_t old_value = load16(&header[at]);
+    store16(&header[at], value);
+
+    uint16_t updated = NetworkUtil::update_sum16(checksum, old_value, value);
+    ASSERT_EQ(updated, recompute(header)) << "at " << at << " k " << k;
+    zeros += updated == 0x0000;
+  }
+  EXPECT_GT(zeros, 0);
+}
+
+TEST(Checksum, UpdateSum32MatchesRecompute) {
+  std::mt19937 random(3);
+  // 14 and 16 cross the 32-bit words of the header.
+  std::vector<size_t> offsets = {0, 2, 4, 6, 12, 14, 16};
+  std::vector<uint32_t> edges = {0x00000000, 0xFFFFFFFF, 0x0000FFFF,
+                                 0xFFFF0000};
+  for (size_t k = 0; k < 10000; k++) {
+    Header header = randomHeader(random);
+    size_t at = offsets[k % offsets.size()];
+    uint32_t value = k % 2 ? random() : edges[(k / 2) % edges.size()];
+    uint16_t checksum = load16(&header[CHECKSUM]);
+    uint32_t old_value =
+        ((uint32_t)load16(&header[at]) << 16) | load16(&header[at + 2]);
+    store16(&header[at], value >> 16);
+    store16(&header[at + 2], value & 0xFFFF);
+
+    ASSERT_EQ(NetworkUtil::update_sum32(checksum, old_value, value),
+              recompute(header))
+        << "at " << at << " k " << k;
+  }
+}
+
+TEST(Checksum, OddAlignedWordUpdatesWithSwappedBytes) {
+  std::mt19937 random(4);
+  auto swap = [](uint16_t value) {
+    return (uint16_t)((value << 8) | (value >> 8));
+  };
+  // Each of them is clear of the checksum (bytes 10 and 11).
+  std::vector<size_t> offsets = {1, 3, 5, 7, 13, 15, 17};
+  for (size_t k = 0; k < 10000; k++) {
+    Header header = randomHeader(random);
+    size_t at = offsets[k % offsets.size()];
+    uint16_t value = k % 3 == 0 ? 0xFFFF : k % 3 == 1 ? 0x0000 : random();
+    uint16_t checksum = load16(&header[CHECKSUM]);
+    uint16_t old_value = load16(&header[at]);
+    store16(&header[at], value);
+
+    ASSERT_EQ(NetworkUtil::update_sum16(checksum, swap(old_value), swap(value)),
+              recompute(header))
+        << "at " << at << " k " << k;
+  }
+}
+
+TEST(Checksum, PacketUpdateFieldMatchesRecompute) {
+  std::mt19937 random(5);
+  // The header starts at an odd offset of the packet.
+  const size_t start = 15;
+  for (size_t k = 0; k < 1000; k++) {
+    Header header = randomHeader(random);
+    Packet packet(start + header.size());
+    packet.writeData(start, header.data(), header.size());
+
+    size_t at = 2 * (random() % 10);
+    if (at != CHECKSUM && at != CHECKSUM - 2) {
+      uint32_t value = k % 4 == 0 ? 0xFFFFFFFF : k % 4 == 1 ? 0 : random();
+      if (k % 2) {
+        ASSERT_TRUE(
+            packet.updateField16(start + at, value, start + CHECKSUM));
+        store16(&header[at], value);
+      } else if (at <= 16) {
+        ASSERT_TRUE(
+            packet.updateField32(start + at, value, start + CHECKSUM));
+        store16(&header[at], value >> 16);
+        store16(&header[at + 2], value & 0xFFFF);
+      }
+    }
+    Header updated;
+    packet.readData(start, updated.data(), updated.size());
+    ASSERT_EQ(load16(&updated[CHECKSUM]), recompute(header))
+        << "at " << at << " k " << k;
+    store16(&header[CHECKSUM], recompute(header));
+    ASSERT_EQ(updated, header);
+  }
+
+  Packet packet(start + 20);
+  EXPECT_FALSE(packet.updateField16(start + 19, 1, start + CHECKSUM));
+  EXPECT_FALSE(packet.updateField32(start + 18, 1, start + CHECKSUM));
+  EXPECT_FALSE(packet.updateField16(start, 1, start + 19));
+}
+
+TEST(Checksum, IPv4UpdateSettersMatchRecompute) {
+  std::mt19937 random(6);
+  Header header = randomHeader(random);
+  Packet packet(14 + header.size());
+  packet.writeData(14, header.data(), header.size());
+  IPv4HeaderView ip(packet);
+
+  for (size_t k = 0; k < 10000; k++) {
+    switch (k % 4) {
+    case 0:
+      ip.updateTTL(k % 8 == 0 ? 0 : k % 8 == 4 ? 0xFF : random() & 0xFF);
+      break;
+    case 1:
+      // The type of service is the odd byte of its word.
+      ip.updateTypeOfService(k % 8 == 1 ? 0 : random() & 0xFF);
+      break;
+    case 2:
+      ip.updateSource(k % 8 == 2 ? ipv4_t{255, 255, 255, 255}
+                                 : ipv4_t{(uint8_t)random(), 0, 0,
+                                          (uint8_t)random()});
+      break;
+    default:
+      ip.updateDestination(k % 8 == 3 ? ipv4_t{0, 0, 0, 0}
+                                      : ipv4_t{(uint8_t)random(),
+                                               (uint8_t)random(),
+                                               (uint8_t)random(), 255});
+      break;
+    }
+    packet.readData(14, header.data(), header.size());
+    ASSERT_EQ(ip.getChecksum(), recompute(header)) << "k " << k;
+  }
+}
@@ -0,0 +1,192 @@
+/*
+ * testcpumodel.cpp
+ */
+
+#include <E/Networking/E_HeaderView.hpp>
+#include <E/Networking/E_TimerModule.hpp>
+
+#include "testenv.hpp"
+
+// Stands in for TCP: records when each READ arrives and completes it.
+class ArrivalLog : public SystemCallInterface {
+public:
+  ArrivalLog(Host &host, std::vector<Time> &arrivals)
+      : SystemCallInterface(AF_INET, IPPROTO_TCP, host), host(host),
+        arrivals(arrivals) {}
+
+protected:
+  Host &host;
+  std::vector<Time> &arrivals;
+
+  virtual void systemCallback(UUID syscallUUID, int pid,
+                              const SystemCallParameter &param) final {
+    if (param.syscallNumber == SOCKET) {
+      returnSystemCall(syscallUUID, createFileDescriptor(pid));
+      return;
+    }
+    arrivals.push_back(host.getCurrentTime());
+    returnSystemCall(syscallUUID, 0);
+  }
+};
+
+// Exposes E_SyscallPrepare-based calls to the test body.
+class SubmittingApp : public ScriptApp {
+public:
+  using ScriptApp::ScriptApp;
+  using TCPApplication::prepareRead;
+  using SystemCallApplication::E_SyscallReap;
+  using SystemCallApplication::E_SyscallSubmit;
+};
+
+// Sends one UDP packet every 10 us straight to the port, cycling over
+// flows with source ports 1000, 1001, ...
+class FlowSource : public HostModule, public TimerModule {
+public:
+  FlowSource(Host &host, size_t flows, size_t toSend)
+      : HostModule("Source", host), TimerModule("Source", host), flows(flows),
+        toSend(toSend) {
+    addTimer(0, 0);
+  }
+
+protected:
+  size_t flows;
+  size_t toSend;
+  size_t sent = 0;
+
+  virtual void timerCallback(std::any payload) final {
+    (void)payload;
+    Packet packet(EthernetHeaderView::SIZE + IPv4HeaderView::SIZE + 8 + 100);
+    EthernetHeaderView ethernet(packet);
+    ethernet.setEtherType(EthernetHeaderView::ETHERTYPE_IPV4);
+    IPv4HeaderView ip(packet);
+    ip.setVersionAndHeaderLength(4, 5);
+    ip.setTotalLength(packet.getSize() - EthernetHeaderView::SIZE);
+    ip.setProtocol(0x11);
+    ip.setSource({10, 0, 0, 1});
+    ip.setDestination({10, 0, 0, 2});
+    UDPHeaderView udp(packet, EthernetHeaderView::SIZE + IPv4HeaderView::SIZE);
+    udp.setSourcePort(1000 + sent % flows);
+    udp.setDestinationPort(80);
+    sendPacket("Host", std::move(packet));
+    if (++sent < toSend)
+      addTimer(0, TimeUtil::makeTime(10, TimeUtil::USEC));
+  }
+
+  virtual void packetArrived(std::string fromModule, Packet &&packet) final {
+    (void)fromModule;
+    (void)packet;
+  }
+};
+
+class CPUModel : public ::testing::Test {
+protected:
+  NetworkSystem system;
+  std::shared_ptr<Host> host;
+
+  // Creates host and wires it to a second Host, which is returned.
+  std::shared_ptr<Host> connectPeer() {
+    host = system.addModule<Host>("Host", system);
+    auto peer = system.addModule<Host>("Peer", system);
+    auto ports = system.addWire(*host, *peer).second;
+    host->setMACAddr({0, 0, 0, 0, 0, 1}, ports.first);
+    peer->setMACAddr({0, 0, 0, 0, 0, 2}, ports.second);
+    return peer;
+  }
+
+  virtual void TearDown() { host.reset(); }
+};
+
+static Time usec(Time value) {
+  return TimeUtil::makeTime(value, TimeUtil::USEC);
+}
+
+TEST_F(CPUModel, SubmittedCallsAreChargedOneByOne) {
+  std::vector<Time> arrivals;
+  host = system.addModule<Host>("Host", system);
+  host->addHostModule<ArrivalLog>(*host, arrivals);
+  Host::CPUModel model;
+  model.perSyscall = usec(10);
+  host->setCPUModel(model);
+
+  std::vector<Time> reaped;
+  host->launchApplication(host->addApplication<SubmittingApp>(
+      *host, [&](ScriptApp &script) {
+        auto &app = static_cast<SubmittingApp &>(script);
+        int fd = app.socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        char buffer[4];
+        for (uint64_t k = 0; k < 3; k++)
+          app.prepareRead(fd, buffer, sizeof(buffer), k);
+        EXPECT_EQ(app.E_SyscallSubmit(1), 3);
+        reaped.push_back(app.now());
+        EXPECT_EQ(app.E_SyscallSubmit(3), 0);
+        reaped.push_back(app.now());
+
+        SystemCallApplication::Completion completions[3];
+        EXPECT_EQ(app.E_SyscallReap(completions, 3), 3);
+      }));
+  system.run(0);
+
+  // socket() takes 10 us, then each read waits for the one before it.
+  std::vector<Time> expected = {usec(20), usec(30), usec(40)};
+  EXPECT_EQ(arrivals, expected);
+  // The first completion wakes the process before the others are served.
+  expected = {usec(20), usec(40)};
+  EXPECT_EQ(reaped, expected);
+  EXPECT_EQ(host->cleanUp(), 0);
+}
+
+// Number of packets each core of host has sent, given that each costs
+// perPacket and none of them queued.
+static std::vector<size_t> packetsPerCore(Host &host, Time perPacket) {
+  Host::CPUModel model = host.getCPUModel().value();
+  Time elapsed = host.getCurrentTime();
+  std::vector<size_t> packets;
+  for (size_t core = 0; core < model.cores; core++)
+    packets.push_back((size_t)std::llround(host.getCoreUtilization(core) *
+                                           elapsed / perPacket));
+  return packets;
+}
+
+TEST_F(CPUModel, FlowStaysOnOneCore) {
+  auto peer = connectPeer();
+  host->addHostModule<FlowSource>(*host, 1, 16);
+  Host::CPUModel model;
+  model.perPacket = usec(1);
+  model.cores = 16;
+  host->setCPUModel(model);
+  system.run(0);
+  peer.reset();
+
+  auto packets = packetsPerCore(*host, model.perPacket);
+  EXPECT_EQ(*std::max_element(packets.begin(), packets.end()), 16);
+  EXPECT_EQ(std::count(packets.begin(), packets.end(), 0), 15);
+}
+
+// Measures how 16 equal flows spread over 16 cores. Only port traffic and
+// system calls are charged (see Host::setCPUModel), so this is the
+// imbalance of receive-side scaling alone.
+TEST_F(CPUModel, SixteenFlowsOnSixteenCores) {
+  auto peer = connectPeer();
+  const size_t flows = 16, rounds = 10;
+  host->addHostModule<FlowSource>(*host, flows, flows * rounds);
+  Host::CPUModel model;
+  model.perPacket = usec(1);
+  model.cores = 16;
+  host->setCPUModel(model);
+  system.run(0);
+  peer.reset();
+
+  auto packets = packetsPerCore(*host, model.perPacket);
+  size_t busiest = *std::max_element(packets.begin(), packets.end());
+  size_t idle = std::count(packets.begin(), packets.end(), 0);
+  RecordProperty("BusiestCoreFlows", (int)(busiest / rounds));
+  RecordProperty("IdleCores", (int)idle);
+
+  for (size_t count : packets)
+    EXPECT_EQ(count % rounds, 0u); // flows are never split
+  EXPECT_EQ(std::accumulate(packets.begin(), packets.end(), (size_t)0),
+            flows * rounds);
+  // Hashing, unlike an even spread, leaves some cores idle.
+  EXPECT_GT(busiest, rounds);
+  EXPECT_GT(idle, 0u);
+}
@@ -0,0 +1,64 @@
+/*
+ * testenv.hpp
+ */
+
+#ifndef APP_E_TESTENV_HPP_
+#define APP_E_TESTENV_HPP_
+
+#include <E/E_Common.hpp>
+#include <E/E_TimeUtil.hpp>
+#include <E/Networking/E_Host.hpp>
+#include <E/Networking/E_Networking.hpp>
+#include <E/Networking/TCP/E_TCPApplication.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace E;
+
+// Runs a test body as its E_Main.
+class ScriptApp : public TCPApplication {
+public:
+  using Script = std::function<void(ScriptApp &)>;
+  ScriptApp(Host &host, Script script) : TCPApplication(host), script(script) {}
+
+  using TCPApplication::buffer_create;
+  using TCPApplication::close;
+  using TCPApplication::connect;
+  using TCPApplication::epoll_create;
+  using TCPApplication::epoll_ctl;
+  using TCPApplication::epoll_wait;
+  using TCPApplication::fcntl;
+  using TCPApplication::msleep;
+  using TCPApplication::read;
+  using TCPApplication::readv;
+  using TCPApplication::sendfile;
+  using TCPApplication::socket;
+  using TCPApplication::write;
+  using TCPApplication::writev;
+
+  Time now() { return getCurrentTime(); }
+
+protected:
+  Script script;
+
+  virtual int E_Main() final {
+    script(*this);
+    return 0;
+  }
+};
+
+// Launches a ScriptApp on host, runs the System and checks that it finished.
+static inline void runScript(NetworkSystem &system, Host &host,
+                             ScriptApp::Script script) {
+  bool finished = false;
+  host.launchApplication(
+      host.addApplication<ScriptApp>(host, [&](ScriptApp &app) {
+        script(app);
+        finished = true;
+      }));
+  system.run(0);
+  EXPECT_TRUE(finished);
+  EXPECT_EQ(host.cleanUp(), 0);
+}
+
+#endif /* APP_E_TESTENV_HPP_ */
@@ -0,0 +1,185 @@
+/*
+ * testepoll.cpp
+ */
+
+#include <E/Networking/E_TimerModule.hpp>
+
+#include "testenv.hpp"
+
+// Stands in for TCP: one byte becomes readable on each socket some time
+// after it is created, and READ blocks until then unless O_NONBLOCK is set.
+class MockSocket : public SystemCallInterface,
+                   public TypedTimerModule<std::pair<int, int>> {
+public:
+  MockSocket(Host &host, std::optional<Time> arrival)
+      : SystemCallInterface(AF_INET, IPPROTO_TCP, host),
+        TypedTimerModule<std::pair<int, int>>("MockSocket", host),
+        arrival(arrival) {}
+
+protected:
+  using Socket = std::pair<int, int>; // pid, fd
+  std::optional<Time> arrival;
+  std::set<Socket> readable;
+  std::map<Socket, UUID> blockedReads;
+
+  virtual void systemCallback(UUID syscallUUID, int pid,
+                              const SystemCallParameter &param) final {
+    switch (param.syscallNumber) {
+    case SOCKET: {
+      int fd = createFileDescriptor(pid);
+      if (fd >= 0 && arrival.has_value())
+        addTimer({pid, fd}, arrival.value());
+      returnSystemCall(syscallUUID, fd);
+      break;
+    }
+    case READ: {
+      Socket socket{pid, std::get<int>(param.params[0])};
+      if (readable.erase(socket) > 0) {
+        setFileDescriptorEvents(pid, socket.second, 0);
+        returnSystemCall(syscallUUID, 1);
+      } else if (isNonBlocking(pid, socket.second)) {
+        returnSystemCall(syscallUUID, -EAGAIN);
+      } else {
+        blockedReads[socket] = syscallUUID;
+      }
+      break;
+    }
+    case CLOSE: {
+      Socket socket{pid, std::get<int>(param.params[0])};
+      readable.erase(socket);
+      removeFileDescriptor(pid, socket.second);
+      returnSystemCall(syscallUUID, 0);
+      break;
+    }
+    default:
+      returnSystemCall(syscallUUID, -EINVAL);
+      break;
+    }
+  }
+
+  virtual void timerCallback(Socket &socket) final {
+    auto blocked = blockedReads.find(socket);
+    if (blocked != blockedReads.end()) {
+      returnSystemCall(blocked->second, 1);
+      blockedReads.erase(blocked);
+      return;
+    }
+    readable.insert(socket);
+    setFileDescriptorEvents(socket.first, socket.second, POLLIN);
+  }
+};
+
+using EpollEvent = SystemCallInterface::EpollEvent;
+
+class Epoll : public ::testing::Test {
+protected:
+  NetworkSystem system;
+  std::shared_ptr<Host> host;
+
+  // Data arrives on every socket this long after it is created, or never.
+  void run(std::optional<Time> arrival, ScriptApp::Script script) {
+    host = system.addModule<Host>("Host", system);
+    host->addHostModule<MockSocket>(*host, arrival);
+    runScript(system, *host, script);
+  }
+
+  virtual void TearDown() { host.reset(); }
+};
+
+static Time msec(Time value) {
+  return TimeUtil::makeTime(value, TimeUtil::MSEC);
+}
+
+TEST_F(Epoll, WaitWakesOnReadiness) {
+  run(msec(1), [](ScriptApp &app) {
+    int fd = app.socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    int epfd = app.epoll_create(1);
+    EpollEvent event{POLLIN, 42}, out[4];
+    EXPECT_EQ(app.epoll_ctl(epfd, SystemCallInterface::EPOLL_ADD, fd, &event),
+              0);
+
+    EXPECT_EQ(app.epoll_wait(epfd, out, 4, -1), 1);
+    EXPECT_EQ(app.now(), msec(1));
+    EXPECT_EQ(out[0].data, 42);
+    EXPECT_EQ(out[0].events, POLLIN);
+
+    // Level-triggered: reported until the data is read.
+    EXPECT_EQ(app.epoll_wait(epfd, out, 4, 0), 1);
+    char byte;
+    EXPECT_EQ(app.read(fd, &byte, 1), 1);
+    EXPECT_EQ(app.epoll_wait(epfd, out, 4, 0), 0);
+  });
+}
+
+TEST_F(Epoll, WaitTimesOut) {
+  run({}, [](ScriptApp &app) {
+    int fd = app.socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    int epfd = app.epoll_create(1);
+    EpollEvent event{POLLIN, 0}, out[4];
+    app.epoll_ctl(epfd, SystemCallInterface::EPOLL_ADD, fd, &event);
+
+    EXPECT_EQ(app.epoll_wait(epfd, out, 4, 5), 0);
+    EXPECT_EQ(app.now(), msec(5));
+  });
+}
+
+TEST_F(Epoll, DeletedDescriptorIsNotReported) {
+  run(msec(1), [](ScriptApp &app) {
+    int fd = app.socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    int epfd = app.epoll_create(1);
+    EpollEvent event{POLLIN, 0}, out[4];
+    app.epoll_ctl(epfd, SystemCallInterface::EPOLL_ADD, fd, &event);
+    EXPECT_EQ(app.epoll_ctl(epfd, SystemCallInterface::EPOLL_DEL, fd, nullptr),
+              0);
+    EXPECT_EQ(app.epoll_ctl(epfd, SystemCallInterface::EPOLL_DEL, fd, nullptr),
+              -ENOENT);
+
+    // The data arriving at 1 ms wakes nobody.
+    EXPECT_EQ(app.epoll_wait(epfd, out, 4, 3), 0);
+    EXPECT_EQ(app.now(), msec(3));
+  });
+}
+
+TEST_F(Epoll, CloseRemovesDescriptor) {
+  run(msec(1), [](ScriptApp &app) {
+    int fd = app.socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    int epfd = app.epoll_create(1);
+    EpollEvent event{POLLIN, 0}, out[4];
+    app.epoll_ctl(epfd, SystemCallInterface::EPOLL_ADD, fd, &event);
+    app.msleep(2);
+    EXPECT_EQ(app.epoll_wait(epfd, out, 4, 0), 1);
+
+    EXPECT_EQ(app.close(fd), 0);
+    EXPECT_EQ(app.epoll_wait(epfd, out, 4, 0), 0);
+    EXPECT_EQ(app.close(epfd), 0);
+    EXPECT_EQ(app.epoll_wait(epfd, out, 4, 0), -EBADF);
+  });
+}
+
+TEST_F(Epoll, NonBlockingReadReturnsEagain) {
+  run(msec(1), [](ScriptApp &app) {
+    int fd = app.socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    EXPECT_EQ(app.fcntl(fd, F_SETFL, O_NONBLOCK), 0);
+    char byte;
+    EXPECT_EQ(app.read(fd, &byte, 1), -EAGAIN);
+    EXPECT_EQ(app.now(), 0);
+
+    // Blocking again, the read waits for the data.
+    EXPECT_EQ(app.fcntl(fd, F_SETFL, 0), 0);
+    EXPECT_EQ(app.read(fd, &byte, 1), 1);
+    EXPECT_EQ(app.now(), msec(1));
+  });
+}
+
+TEST_F(Epoll, SocketCallsOnEpollFail) {
+  run({}, [](ScriptApp &app) {
+    int epfd = app.epoll_create(1);
+    char byte = 0;
+    sockaddr_in address{};
+    EXPECT_EQ(app.read(epfd, &byte, 1), -EINVAL);
+    EXPECT_EQ(app.write(epfd, &byte, 1), -EINVAL);
+    EXPECT_EQ(app.connect(epfd, (sockaddr *)&address, sizeof(address)),
+              -EINVAL);
+    EXPECT_EQ(app.close(epfd), 0);
+  });
+}
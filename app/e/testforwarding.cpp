@@ -0,0 +1,184 @@
+/*
+ * testforwarding.cpp
+ */
+
+#include <E/E_Common.hpp>
+#include <E/E_TimeUtil.hpp>
+#include <E/Networking/E_HeaderView.hpp>
+#include <E/Networking/E_Host.hpp>
+#include <E/Networking/E_NetworkUtil.hpp>
+#include <E/Networking/E_Networking.hpp>
+#include <E/Networking/E_Switch.hpp>
+#include <E/Networking/E_TimerModule.hpp>
+#include <E/Networking/Ethernet/E_Ethernet.hpp>
+#include <E/Networking/IPv4/E_IPv4.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace E;
+
+// Stands in for TCP: sends IPv4 packets and checks the ones it receives.
+class RawTransport : public HostModule, public TimerModule {
+public:
+  class Counters {
+  public:
+    size_t received = 0;
+    size_t complete = 0; // valid IPv4 checksum and no offload mark
+    size_t marked = 0;   // IPv4 checksum left to the NIC
+    size_t zeroMAC = 0;  // both Ethernet addresses zero
+  };
+
+  RawTransport(Host &host, size_t toSend, ipv4_t source, ipv4_t destination,
+               Counters &counters)
+      : HostModule("TCP", host), TimerModule("TCP", host), toSend(toSend),
+        source(source), destination(destination), counters(counters) {
+    if (toSend > 0)
+      addTimer(0, 0);
+  }
+
+protected:
+  size_t toSend;
+  ipv4_t source;
+  ipv4_t destination;
+  Counters &counters;
+
+  virtual void timerCallback(std::any payload) final {
+    (void)payload;
+    Packet packet(14 + 20 + 20 + 1000);
+    // Garbage in the Ethernet header, which the layers below overwrite
+    std::vector<uint8_t> garbage(12, 0xAA);
+    packet.writeData(0, garbage.data(), garbage.size());
+    packet.writeData(26, source.data(), 4);
+    packet.writeData(30, destination.data(), 4);
+    sendPacket("IPv4", std::move(packet));
+    if (--toSend > 0)
+      addTimer(0, TimeUtil::makeTime(10, TimeUtil::USEC));
+  }
+
+  virtual void packetArrived(std::string fromModule, Packet &&packet) final {
+    (void)fromModule;
+    counters.received++;
+    ConstIPv4HeaderView ip(packet);
+    if (packet.getMetadata().offload == 0 &&
+        NetworkUtil::one_sum(ip.getData(), ip.SIZE) == 0xFFFF)
+      counters.complete++;
+    if (packet.getMetadata().has(PacketMetadata::IPV4_CHECKSUM))
+      counters.marked++;
+    ConstEthernetHeaderView ethernet(packet);
+    if (ethernet.getSource() == mac_t{} && ethernet.getDestination() == mac_t{})
+      counters.zeroMAC++;
+  }
+};
+
+// Captured frames with a valid IPv4 checksum
+static size_t completeFrames(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  file.ignore(24); // pcap file header
+  size_t complete = 0;
+  uint32_t header[4]; // ts_sec, ts_usec, incl_len, orig_len
+  while (file.read((char *)header, sizeof(header))) {
+    std::vector<uint8_t> frame(header[2]);
+    file.read((char *)frame.data(), frame.size());
+    if (frame.size() >= 14 + 20 &&
+        NetworkUtil::one_sum(frame.data() + 14, 20) == 0xFFFF)
+      complete++;
+  }
+  return complete;
+}
+
+// Two Hosts connected by a Switch
+class Forwarding : public ::testing::Test {
+protected:
+  NetworkSystem system;
+  std::shared_ptr<Host> host1;
+  std::shared_ptr<Host> host2;
+  std::shared_ptr<Switch> sw;
+  ipv4_t ip1{10, 0, 0, 1};
+  ipv4_t ip2{10, 0, 0, 2};
+
+  virtual void SetUp() {
+    host1 = system.addModule<Host>("Host1", system);
+    host2 = system.addModule<Host>("Host2", system);
+    sw = system.addModule<Switch>("Switch", system);
+    auto port1 = system.addWire(*host1, *sw).second;
+    auto port2 = system.addWire(*host2, *sw).second;
+
+    mac_t mac1{0, 0, 0, 0, 0, 1}, mac2{0, 0, 0, 0, 0, 2};
+    host1->setMACAddr(mac1, port1.first);
+    host2->setMACAddr(mac2, port2.first);
+    host1->setIPAddr(ip1, port1.first);
+    host2->setIPAddr(ip2, port2.first);
+    host1->setARPTable(mac2, ip2);
+    host2->setARPTable(mac1, ip1);
+    host1->setRoutingTable(ip2, 24, port1.first);
+    host2->setRoutingTable(ip1, 24, port2.first);
+    sw->addMACEntry(port1.second, mac1);
+    sw->addMACEntry(port2.second, mac2);
+
+    for (auto host : {host1, host2}) {
+      host->addHostModule<Ethernet>(*host);
+      host->addHostModule<IPv4>(*host);
+    }
+  }
+
+  virtual void TearDown() {
+    host1.reset();
+    host2.reset();
+    sw.reset();
+  }
+};
+
+TEST_F(Forwarding, UnicastIsNeverCopied) {
+  RawTransport::Counters counters1, counters2;
+  host1->addHostModule<RawTransport>(*host1, 100, ip1, ip2, counters1);
+  host2->addHostModule<RawTransport>(*host2, 0, ip2, ip1, counters2);
+  system.run(0);
+
+  EXPECT_EQ(counters2.received, 100);
+  Packet::Statistics stats = system.getPacketStatistics();
+  EXPECT_EQ(stats.copies, 0);
+  EXPECT_EQ(stats.copiedBytes, 0);
+  // The Switch gives each forwarded frame a new UUID, sharing its buffer.
+  EXPECT_EQ(stats.clones, 100);
+}
+
+TEST_F(Forwarding, OffloadMarkCrossesTheWire) {
+  std::string path = ::testing::TempDir() + "offload.pcap";
+  sw->enablePCAPLogging(path);
+  host1->setChecksumOffload(true);
+  RawTransport::Counters counters1, counters2;
+  host1->addHostModule<RawTransport>(*host1, 10, ip1, ip2, counters1);
+  host2->addHostModule<RawTransport>(*host2, 0, ip2, ip1, counters2);
+  system.run(0);
+  sw.reset();
+
+  // Host2 trusts the mark, and the capture has the checksums filled in.
+  EXPECT_EQ(counters2.received, 10);
+  EXPECT_EQ(counters2.marked, 10);
+  EXPECT_EQ(completeFrames(path), 10);
+  std::remove(path.c_str());
+}
+
+TEST_F(Forwarding, LoopbackIsOptIn) {
+  ipv4_t localhost{127, 0, 0, 1};
+  EXPECT_FALSE(host1->getLoopbackPort().has_value());
+  EXPECT_FALSE(host1->isLoopbackAddress(localhost));
+  EXPECT_FALSE(host1->isLoopbackAddress(ip1));
+
+  host1->setLoopbackPort(Host::LoopbackPort{});
+  EXPECT_TRUE(host1->isLoopbackAddress(localhost));
+  EXPECT_TRUE(host1->isLoopbackAddress(ip1));
+  EXPECT_FALSE(host1->isLoopbackAddress(ip2));
+}
+
+TEST_F(Forwarding, LoopedFramesHaveZeroAddresses) {
+  host1->setLoopbackPort(Host::LoopbackPort{});
+  RawTransport::Counters counters1, counters2;
+  host1->addHostModule<RawTransport>(*host1, 10, ip1, ip1, counters1);
+  host2->addHostModule<RawTransport>(*host2, 0, ip2, ip1, counters2);
+  system.run(0);
+
+  EXPECT_EQ(counters1.received, 10);
+  EXPECT_EQ(counters1.zeroMAC, 10);
+  EXPECT_EQ(counters2.received, 0);
+}
@@ -0,0 +1,174 @@
+/*
+ * testindexallocator.cpp
+ */
+
+#include <E/E_Common.hpp>
+#include <E/E_IndexAllocator.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace E;
+
+// Lowest free index in a plain bool array, the behaviour IndexBitmap models.
+static std::optional<size_t> referenceFindFree(const std::vector<bool> &used,
+                                               size_t from, bool wrap) {
+  for (size_t k = from; k < used.size(); k++)
+    if (!used[k])
+      return k;
+  if (wrap)
+    for (size_t k = 0; k < std::min(from, used.size()); k++)
+      if (!used[k])
+        return k;
+  return {};
+}
+
+class IndexBitmapCapacity : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(IndexBitmapCapacity, FillsInOrderAndStopsAtCapacity) {
+  size_t capacity = GetParam();
+  IndexBitmap bitmap(capacity);
+  for (size_t k = 0; k < capacity; k++) {
+    std::optional<size_t> index = bitmap.findFree();
+    ASSERT_TRUE(index.has_value());
+    ASSERT_EQ(index.value(), k);
+    bitmap.set(k);
+  }
+  // The padding bits of a partial last word are never handed out.
+  EXPECT_FALSE(bitmap.findFree().has_value());
+  EXPECT_FALSE(bitmap.findFree(capacity - 1, true).has_value());
+  EXPECT_FALSE(bitmap.findFree(capacity).has_value());
+
+  bitmap.reset(capacity - 1);
+  EXPECT_EQ(bitmap.findFree(), capacity - 1);
+  bitmap.reset(0);
+  EXPECT_EQ(bitmap.findFree(), 0);
+  if (capacity > 1) {
+    EXPECT_EQ(bitmap.findFree(1), capacity - 1);
+  }
+}
+
+TEST_P(IndexBitmapCapacity, MatchesReference) {
+  size_t capacity = GetParam();
+  IndexBitmap bitmap(capacity);
+  std::vector<bool> used(capacity, false);
+  std::mt19937 rng(capacity);
+
+  for (int step = 0; step < 20000; step++) {
+    size_t index = rng() % capacity;
+    // Mostly allocate, so that whole words and summary words fill up.
+    if (rng() % 4 != 0) {
+      bitmap.set(index);
+      used[index] = true;
+    } else {
+      bitmap.reset(index);
+      used[index] = false;
+    }
+    ASSERT_EQ(bitmap.test(index), used[index]);
+
+    size_t from = rng() % (capacity + 2);
+    bool wrap = rng() % 2;
+    ASSERT_EQ(bitmap.findFree(from, wrap), referenceFindFree(used, from, wrap))
+        << "capacity " << capacity << " from " << from << " wrap " << wrap;
+  }
+}
+
+// Capacities around word (64) and summary word (4096) boundaries.
+INSTANTIATE_TEST_SUITE_P(IndexBitmap, IndexBitmapCapacity,
+                         ::testing::Values(1, 63, 64, 65, 130, 4095, 4096,
+                                           4097, 8192 + 100));
+
+TEST(IndexBitmap, SummarySkipsFullWords) {
+  // Fill the first two summary words, leaving one free index after them.
+  size_t capacity = 3 * 4096;
+  IndexBitmap bitmap(capacity);
+  for (size_t k = 0; k < 2 * 4096 + 10; k++)
+    bitmap.set(k);
+  EXPECT_EQ(bitmap.findFree(), 2 * 4096 + 10);
+  EXPECT_EQ(bitmap.findFree(100), 2 * 4096 + 10);
+
+  // Freeing one index clears the summary bit of its word only.
+  bitmap.reset(4096 + 64 + 5);
+  EXPECT_EQ(bitmap.findFree(), 4096 + 64 + 5);
+  EXPECT_EQ(bitmap.findFree(4096 + 64 + 6), 2 * 4096 + 10);
+  bitmap.set(4096 + 64 + 5);
+  EXPECT_EQ(bitmap.findFree(), 2 * 4096 + 10);
+}
+
+TEST(IndexBitmap, WrapsAround) {
+  IndexBitmap bitmap(200);
+  for (size_t k = 0; k < 200; k++)
+    bitmap.set(k);
+  bitmap.reset(3);
+  bitmap.reset(150);
+
+  EXPECT_EQ(bitmap.findFree(100), 150);
+  EXPECT_EQ(bitmap.findFree(151), std::nullopt);
+  EXPECT_EQ(bitmap.findFree(151, true), 3);
+  // Out of range starts wrap to the beginning too.
+  EXPECT_EQ(bitmap.findFree(200, true), 3);
+  EXPECT_EQ(bitmap.findFree(0, true), 3);
+
+  bitmap.set(3);
+  EXPECT_EQ(bitmap.findFree(151, true), 150);
+}
+
+TEST(SlotMap, ReusedSlotGetsNewGeneration) {
+  SlotMap<std::string> map;
+  SlotMap<std::string>::Key first = map.insert("first");
+  EXPECT_EQ(*map.find(first), "first");
+  EXPECT_TRUE(map.erase(first));
+  EXPECT_EQ(map.find(first), nullptr);
+  EXPECT_FALSE(map.erase(first));
+
+  // The freed slot is reused, but the stale key does not see the new value.
+  SlotMap<std::string>::Key second = map.insert("second");
+  EXPECT_EQ((uint32_t)second, (uint32_t)first);
+  EXPECT_NE(second, first);
+  EXPECT_EQ(map.find(first), nullptr);
+  EXPECT_FALSE(map.erase(first));
+  EXPECT_EQ(*map.find(second), "second");
+  EXPECT_EQ(map.size(), 1);
+}
+
+TEST(SlotMap, UnknownKeysAreNotFound) {
+  SlotMap<int> map;
+  EXPECT_EQ(map.find(0), nullptr);
+  SlotMap<int>::Key key = map.insert(7);
+  EXPECT_EQ(map.find(key + 1), nullptr);
+  EXPECT_EQ(map.find(key + (1ULL << 32)), nullptr);
+  EXPECT_FALSE(map.erase(key + 1));
+  EXPECT_EQ(*map.find(key), 7);
+}
+
+TEST(SlotMap, MatchesReference) {
+  SlotMap<int> map;
+  std::map<SlotMap<int>::Key, int> reference;
+  std::vector<SlotMap<int>::Key> erased;
+  std::mt19937 rng(43);
+
+  for (int step = 0; step < 10000; step++) {
+    if (reference.empty() || rng() % 3 != 0) {
+      int value = rng();
+      SlotMap<int>::Key key = map.insert(value);
+      ASSERT_EQ(reference.count(key), 0);
+      reference[key] = value;
+    } else {
+      auto it = reference.begin();
+      std::advance(it, rng() % reference.size());
+      ASSERT_TRUE(map.erase(it->first));
+      erased.push_back(it->first);
+      reference.erase(it);
+    }
+  }
+
+  EXPECT_EQ(map.size(), reference.size());
+  for (SlotMap<int>::Key key : erased) {
+    if (reference.count(key) == 0) {
+      EXPECT_EQ(map.find(key), nullptr);
+    }
+  }
+
+  std::map<SlotMap<int>::Key, int> visited;
+  map.forEach([&](SlotMap<int>::Key key, int value) { visited[key] = value; });
+  EXPECT_EQ(visited, reference);
+}
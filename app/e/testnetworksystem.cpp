@@ -0,0 +1,46 @@
+/*
+ * testnetworksystem.cpp
+ */
+
+#include <E/E_Common.hpp>
+#include <E/Networking/E_Networking.hpp>
+#include <E/Networking/E_Packet.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace E;
+
+static Size allocations(NetworkSystem &system) {
+  PacketPool::Statistics stats = system.getPacketPoolStatistics();
+  return stats.hits + stats.misses + stats.oversized;
+}
+
+TEST(NetworkSystem, NewestSystemIsInstalled) {
+  NetworkSystem a;
+  {
+    NetworkSystem b;
+    Packet packet(100);
+    EXPECT_EQ(allocations(a), 0);
+    EXPECT_EQ(allocations(b), 1);
+  }
+  Packet packet(100);
+  EXPECT_EQ(allocations(a), 1);
+}
+
+TEST(NetworkSystem, DestroyOutOfOrder) {
+  auto a = std::make_unique<NetworkSystem>();
+  auto b = std::make_unique<NetworkSystem>();
+  a.reset();
+  {
+    Packet packet(100);
+    Packet copy = packet.clone();
+    EXPECT_EQ(allocations(*b), 1);
+    EXPECT_EQ(b->getPacketStatistics().clones, 1);
+  }
+  b.reset();
+
+  // Nothing is installed any more, so storage comes from the heap.
+  Packet packet(100);
+  Packet copy = packet.clone();
+  EXPECT_EQ(packet.getSize(), 100);
+}
@@ -0,0 +1,158 @@
+/*
+ * testpacket.cpp
+ */
+
+#include <E/E_Common.hpp>
+#include <E/Networking/E_Host.hpp>
+#include <E/Networking/E_Networking.hpp>
+#include <E/Networking/E_Packet.hpp>
+#include <E/Networking/E_Switch.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace E;
+
+// A 20-byte header (bytes 0..19) followed by two payload segments
+// (bytes 100..109 and 200..204), attached by reference.
+class Segmented : public ::testing::Test {
+protected:
+  PacketBuffer first = PacketBuffer::allocate(10, false);
+  PacketBuffer second = PacketBuffer::allocate(5, false);
+  Packet packet = Packet(20);
+
+  virtual void SetUp() {
+    for (size_t k = 0; k < 20; k++)
+      *packet.map(k, 1) = k;
+    for (size_t k = 0; k < 10; k++)
+      first.data()[k] = 100 + k;
+    for (size_t k = 0; k < 5; k++)
+      second.data()[k] = 200 + k;
+    packet.appendPayload(first, 0, 10);
+    packet.appendPayload(second, 0, 5);
+  }
+
+  std::vector<uint8_t> read(size_t offset, size_t length) const {
+    std::vector<uint8_t> data(length);
+    data.resize(packet.readData(offset, data.data(), length));
+    return data;
+  }
+};
+
+TEST_F(Segmented, ReadAcrossBoundaries) {
+  EXPECT_EQ(packet.getSize(), 35);
+  EXPECT_EQ(packet.getSegmentCount(), 2);
+  EXPECT_EQ(read(18, 4), std::vector<uint8_t>({18, 19, 100, 101}));
+  EXPECT_EQ(read(28, 4), std::vector<uint8_t>({108, 109, 200, 201}));
+  EXPECT_EQ(read(33, 4), std::vector<uint8_t>({203, 204}));
+  EXPECT_EQ(packet.peek(18, 4), nullptr);
+}
+
+TEST_F(Segmented, ReadOutOfRangeDoesNotWrap) {
+  uint8_t data[4];
+  size_t huge = std::numeric_limits<size_t>::max();
+  EXPECT_EQ(packet.readData(huge - 2, data, 4), 0);
+  EXPECT_EQ(packet.readData(huge, data, 1), 0);
+  std::vector<uint8_t> all(packet.getSize());
+  EXPECT_EQ(packet.readData(2, all.data(), huge), packet.getSize() - 2);
+}
+
+TEST_F(Segmented, WriteAcrossBoundariesCopiesSegments) {
+  std::vector<uint8_t> data = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14};
+  EXPECT_EQ(packet.writeData(18, data.data(), data.size()), data.size());
+  EXPECT_EQ(read(17, 16), std::vector<uint8_t>({17, 1, 2, 3, 4, 5, 6, 7, 8,
+                                                9, 10, 11, 12, 13, 14, 202}));
+  // The referenced buffers are not modified.
+  EXPECT_EQ((uint8_t)first.data()[0], 100);
+  EXPECT_EQ((uint8_t)second.data()[0], 200);
+  EXPECT_EQ(packet.getSegmentCount(), 2);
+}
+
+TEST_F(Segmented, PullIntoSegments) {
+  EXPECT_EQ(packet.pull(22), 22);
+  EXPECT_EQ(packet.getSize(), 13);
+  EXPECT_EQ(packet.getSegmentCount(), 2);
+  EXPECT_EQ(read(0, 2), std::vector<uint8_t>({102, 103}));
+
+  EXPECT_EQ(packet.pull(9), 9);
+  EXPECT_EQ(packet.getSegmentCount(), 1);
+  EXPECT_EQ(read(0, 4), std::vector<uint8_t>({201, 202, 203, 204}));
+
+  EXPECT_EQ(packet.pull(10), 4);
+  EXPECT_EQ(packet.getSize(), 0);
+  EXPECT_EQ(packet.getSegmentCount(), 0);
+}
+
+TEST_F(Segmented, SetSizeTrimsAndGrows) {
+  EXPECT_EQ(packet.setSize(25), 25);
+  EXPECT_EQ(packet.getSegmentCount(), 1);
+  EXPECT_EQ(read(19, 10), std::vector<uint8_t>({19, 100, 101, 102, 103, 104}));
+
+  EXPECT_EQ(packet.setSize(30), 30);
+  EXPECT_EQ(packet.getSegmentCount(), 0);
+  EXPECT_EQ(read(23, 7), std::vector<uint8_t>({103, 104, 0, 0, 0, 0, 0}));
+
+  EXPECT_EQ(packet.setSize(10), 10);
+  EXPECT_EQ(read(8, 4), std::vector<uint8_t>({8, 9}));
+}
+
+TEST_F(Segmented, LinearizeKeepsContentAndMarks) {
+  packet.setLayerOffset(Packet::NETWORK_LAYER, 4);
+  std::vector<uint8_t> before = read(0, packet.getSize());
+  packet.linearize();
+  EXPECT_EQ(packet.getSegmentCount(), 0);
+  EXPECT_EQ(read(0, packet.getSize()), before);
+  EXPECT_NE(packet.peek(18, 4), nullptr);
+  EXPECT_EQ(packet.getLayerOffset(Packet::NETWORK_LAYER), 4);
+}
+
+// Sends a frame through its port when it is initialized.
+class FrameSender : public HostModule {
+public:
+  FrameSender(Host &host, Packet &&frame)
+      : HostModule("Sender", host), frame(std::move(frame)) {}
+
+  virtual void initialize() final { sendPacket("Host", std::move(frame)); }
+
+protected:
+  Packet frame;
+
+  virtual void packetArrived(std::string fromModule, Packet &&packet) final {
+    (void)fromModule;
+    (void)packet;
+  }
+};
+
+TEST_F(Segmented, CaptureGathersSegments) {
+  std::string path = ::testing::TempDir() + "segmented.pcap";
+  mac_t mac{0, 0, 0, 0, 0, 1};
+  packet.writeData(6, mac.data(), mac.size());
+  std::vector<uint8_t> frame = read(0, packet.getSize());
+  {
+    NetworkSystem system;
+    auto host = system.addModule<Host>("Host", system);
+    auto sw = system.addModule<Switch>("Switch", system);
+    auto other = system.addModule<Host>("Other", system);
+    auto port = system.addWire(*host, *sw).second;
+    auto otherPort = system.addWire(*other, *sw).second;
+    host->setMACAddr(mac, port.first);
+    // The destination address is bytes 0..5 of the frame.
+    sw->addMACEntry(otherPort.second, mac_t{0, 1, 2, 3, 4, 5});
+    sw->enablePCAPLogging(path);
+    host->addHostModule<FrameSender>(*host, std::move(packet));
+    host->initializeHostModule("Sender");
+    system.run(0);
+    host.reset();
+    other.reset();
+    sw.reset();
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  file.ignore(24); // pcap file header
+  uint32_t header[4]; // ts_sec, ts_usec, incl_len, orig_len
+  ASSERT_TRUE(file.read((char *)header, sizeof(header)));
+  EXPECT_EQ(header[2], frame.size());
+  std::vector<uint8_t> captured(header[2]);
+  file.read((char *)captured.data(), captured.size());
+  EXPECT_EQ(captured, frame);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,146 @@
+/*
+ * testpackethops.cpp
+ */
+
+#include <E/E_Common.hpp>
+#include <E/E_System.hpp>
+#include <E/E_TimeUtil.hpp>
+#include <E/Networking/E_Host.hpp>
+#include <E/Networking/E_Networking.hpp>
+#include <E/Networking/E_TimerModule.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace E;
+
+using EventLog = std::vector<std::string>;
+
+// Logs each packet it receives and passes it on to the next stage, if any.
+class Stage : public HostModule {
+public:
+  Stage(Host &host, const std::string &name, const std::string &next,
+        EventLog &log, std::function<void()> onArrival = nullptr)
+      : HostModule(name, host), name(name), next(next), log(log),
+        onArrival(onArrival) {}
+
+protected:
+  std::string name;
+  std::string next;
+  EventLog &log;
+  std::function<void()> onArrival;
+
+  virtual void packetArrived(std::string fromModule, Packet &&packet) final {
+    (void)fromModule;
+    uint8_t tag;
+    packet.readData(0, &tag, 1);
+    log.push_back(name + std::to_string(tag));
+    if (onArrival)
+      onArrival();
+    if (!next.empty())
+      sendPacket(next, std::move(packet));
+  }
+};
+
+// Sends packet 1 into stage A and, at the same instant, schedules a timer
+// which sends packet 2.
+class Source : public HostModule, public TimerModule {
+public:
+  Source(Host &host, EventLog &log, bool secondTimer)
+      : HostModule("Source", host), TimerModule("Source", host), log(log),
+        secondTimer(secondTimer) {
+    addTimer(1, TimeUtil::makeTime(1, TimeUtil::USEC));
+  }
+
+protected:
+  EventLog &log;
+  bool secondTimer;
+
+  virtual void timerCallback(std::any payload) final {
+    uint8_t tag = std::any_cast<int>(payload);
+    log.push_back("timer" + std::to_string(tag));
+    Packet packet(64);
+    packet.writeData(0, &tag, 1);
+    sendPacket("A", std::move(packet));
+    if (tag == 1 && secondTimer)
+      addTimer(2, 0);
+  }
+
+  virtual void packetArrived(std::string fromModule, Packet &&packet) final {
+    (void)fromModule;
+    (void)packet;
+  }
+};
+
+// Logs once when started and once more each time it is readied.
+class Logger : public Runnable {
+public:
+  Logger(EventLog &log) : log(log) {}
+
+protected:
+  EventLog &log;
+
+  virtual void main() final {
+    log.push_back("run1");
+    wait();
+    log.push_back("run2");
+  }
+};
+
+class PacketHops : public ::testing::Test {
+protected:
+  NetworkSystem system;
+  std::shared_ptr<Host> host;
+  EventLog log;
+  std::function<void()> onStageB;
+
+  virtual void SetUp() {
+    host = system.addModule<Host>("Host", system);
+    host->addHostModule<Stage>(*host, "A", "B", log);
+    host->addHostModule<Stage>(*host, "B", "C", log, [this] {
+      if (onStageB)
+        onStageB();
+    });
+    host->addHostModule<Stage>(*host, "C", "", log);
+  }
+
+  virtual void TearDown() { host.reset(); }
+};
+
+// With one message per hop, each hop is queued behind every message already
+// scheduled for the same instant, so the timer set at A's send time runs
+// between hops of packet 1, and the two packets interleave stage by stage.
+TEST_F(PacketHops, SameInstantTimerRunsBetweenHops) {
+  host->addHostModule<Source>(*host, log, true);
+  system.run(0);
+
+  EventLog expected = {"timer1", "A1", "timer2", "B1",
+                       "A2",     "C1", "B2",     "C2"};
+  EXPECT_EQ(log, expected);
+}
+
+TEST_F(PacketHops, SinglePacketRunsToCompletion) {
+  host->addHostModule<Source>(*host, log, false);
+  system.run(0);
+
+  EventLog expected = {"timer1", "A1", "B1", "C1"};
+  EXPECT_EQ(log, expected);
+  // One PacketPass carried all three hops.
+  EXPECT_EQ(system.getPendingMessageCount(), 0);
+}
+
+// A Runnable readied during a hop runs before the next hop is delivered,
+// as it would before the next message.
+TEST_F(PacketHops, ReadyRunnableRunsBetweenHops) {
+  auto logger = std::make_shared<Logger>(log);
+  logger->start();
+  system.addRunnable(logger);
+  onStageB = [&] {
+    logger->ready();
+    system.addRunnable(logger);
+  };
+  host->addHostModule<Source>(*host, log, false);
+  system.run(0);
+
+  EventLog expected = {"run1", "timer1", "A1", "B1", "run2", "C1"};
+  EXPECT_EQ(log, expected);
+}
@@ -0,0 +1,56 @@
+/*
+ * testpackettracker.cpp
+ */
+
+#include <E/E_Common.hpp>
+#include <E/Networking/E_Networking.hpp>
+#include <E/Networking/E_Packet.hpp>
+#include <E/Networking/E_PacketTracker.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace E;
+
+#ifdef ENABLE_PACKET_TRACE
+TEST(PacketTracker, RecordsAreDroppedWhenFreed) {
+  NetworkSystem system;
+  PacketTracker *tracker = system.getPacketTracker();
+
+  UUID parentID, cloneID;
+  {
+    std::optional<Packet> parent(Packet(100));
+    Packet clone = parent->clone();
+    parentID = parent->getUUID();
+    cloneID = clone.getUUID();
+    parent.reset();
+
+    // The clone still needs the history of its parent.
+    ASSERT_NE(tracker->getRecord(parentID), nullptr);
+    ASSERT_NE(tracker->getRecord(cloneID), nullptr);
+    EXPECT_EQ(tracker->getAlivePackets(), std::vector<UUID>{cloneID});
+  }
+  EXPECT_EQ(tracker->getRecord(parentID), nullptr);
+  EXPECT_EQ(tracker->getRecord(cloneID), nullptr);
+  EXPECT_TRUE(tracker->getAlivePackets().empty());
+}
+
+TEST(PacketTracker, CopiesShareRecord) {
+  NetworkSystem system;
+  PacketTracker *tracker = system.getPacketTracker();
+
+  UUID uuid;
+  {
+    Packet packet(100);
+    uuid = packet.getUUID();
+    {
+      Packet copy = packet;
+      (void)copy;
+    }
+    ASSERT_NE(tracker->getRecord(uuid), nullptr);
+  }
+  EXPECT_EQ(tracker->getRecord(uuid), nullptr);
+  EXPECT_EQ(tracker->reportLeaks(), 0);
+}
+#else
+TEST(PacketTracker, Disabled) { GTEST_SKIP() << "built without PACKET_TRACE"; }
+#endif
@@ -0,0 +1,77 @@
+/*
+ * testsampler.cpp
+ */
+
+#include <E/E_Common.hpp>
+#include <E/E_Module.hpp>
+#include <E/E_TimeUtil.hpp>
+#include <E/Networking/E_Networking.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace E;
+
+// Sends itself one message and cancels another one, which is due later.
+class OneShot : public Module {
+public:
+  Time delivered = 0;
+
+  OneShot(System &system) : Module(system) {}
+
+  void start(Time live, Time cancelled) {
+    sendMessageSelf(std::make_unique<EmptyMessage>(), live);
+    UUID timer = sendMessageSelf(std::make_unique<EmptyMessage>(), cancelled);
+    cancelMessage(timer);
+  }
+
+protected:
+  virtual Module::Message messageReceived(const ModuleID from,
+                                          Module::MessageBase &message) final {
+    (void)from;
+    (void)message;
+    delivered = getCurrentTime();
+    return nullptr;
+  }
+  virtual void messageFinished(const ModuleID to, Module::Message message,
+                               Module::MessageBase &response) final {
+    (void)to;
+    (void)message;
+    (void)response;
+  }
+  virtual void messageCancelled(const ModuleID to,
+                                Module::Message message) final {
+    (void)to;
+    (void)message;
+  }
+};
+
+TEST(Sampler, StopsWithOtherEvents) {
+  NetworkSystem system;
+  Time ms = TimeUtil::makeTime(1, TimeUtil::MSEC);
+  system.addModule<OneShot>(system)->start(10 * ms, 10 * ms);
+  Sampler::ProbeID probe = system.addProbe("one", ms, [] { return 1.0; });
+  system.run(0);
+
+  const std::vector<Time> &ticks = system.getSampler().getTickTimes();
+  ASSERT_EQ(ticks.size(), 10);
+  EXPECT_EQ(ticks.front(), ms);
+  EXPECT_EQ(ticks.back(), 10 * ms);
+  EXPECT_EQ(system.getSampler().getSamples(probe).size(), 10);
+}
+
+TEST(Sampler, IgnoresCancelledEvents) {
+  NetworkSystem system;
+  Time ms = TimeUtil::makeTime(1, TimeUtil::MSEC);
+  OneShot *module = system.addModule<OneShot>(system).get();
+  module->start(10 * ms, 1000 * ms);
+  system.addProbe("one", ms, [] { return 1.0; });
+  EXPECT_EQ(system.getPendingMessageCount(), 2);
+  system.run(0);
+
+  // A cancelled timer (e.g. an RTO) does not keep the Sampler running.
+  const std::vector<Time> &ticks = system.getSampler().getTickTimes();
+  EXPECT_EQ(module->delivered, 10 * ms);
+  ASSERT_FALSE(ticks.empty());
+  EXPECT_EQ(ticks.back(), 10 * ms);
+  EXPECT_EQ(system.getPendingMessageCount(), 0);
+}
@@ -0,0 +1,138 @@
+/*
+ * testsyscallexit.cpp
+ */
+
+#include <E/E_Common.hpp>
+#include <E/E_TimeUtil.hpp>
+#include <E/Networking/E_Host.hpp>
+#include <E/Networking/E_Networking.hpp>
+#include <E/Networking/E_TimerModule.hpp>
+#include <E/Networking/TCP/E_TCPApplication.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace E;
+
+// Stands in for TCP: READ completes at once, ACCEPT only after a second.
+class MockTransport : public SystemCallInterface,
+                      public TypedTimerModule<UUID> {
+public:
+  class Counters {
+  public:
+    size_t reads = 0;
+    size_t accepts = 0;
+    size_t lateReturns = 0; // ACCEPTs returned after their caller exited
+  };
+
+  MockTransport(Host &host, Counters &counters)
+      : SystemCallInterface(AF_INET, IPPROTO_TCP, host),
+        TypedTimerModule<UUID>("MockTransport", host), counters(counters) {}
+
+protected:
+  Counters &counters;
+
+  virtual void systemCallback(UUID syscallUUID, int pid,
+                              const SystemCallParameter &param) final {
+    switch (param.syscallNumber) {
+    case SOCKET:
+      returnSystemCall(syscallUUID, createFileDescriptor(pid));
+      break;
+    case READ:
+      counters.reads++;
+      returnSystemCall(syscallUUID, 0);
+      break;
+    case ACCEPT:
+      counters.accepts++;
+      addTimer(syscallUUID, TimeUtil::makeTime(1, TimeUtil::SEC));
+      break;
+    default:
+      returnSystemCall(syscallUUID, -1);
+      break;
+    }
+  }
+
+  virtual void timerCallback(UUID &syscallUUID) final {
+    counters.lateReturns++;
+    returnSystemCall(syscallUUID, 0);
+  }
+};
+
+// Returns from E_Main with batched calls in flight.
+class ExitingApp : public TCPApplication {
+public:
+  ExitingApp(Host &host, bool acceptFirst)
+      : TCPApplication(host), acceptFirst(acceptFirst) {}
+
+protected:
+  bool acceptFirst;
+  char buffer[16];
+
+  virtual int E_Main() final {
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (acceptFirst) {
+      // The ACCEPT is served but never completes before exit.
+      prepareAccept(fd, nullptr, nullptr, 1);
+      prepareRead(fd, buffer, sizeof(buffer), 2);
+      E_SyscallSubmit(1);
+    }
+    // Submitted, but not waited for.
+    prepareRead(fd, buffer, sizeof(buffer), 3);
+    prepareRead(fd, buffer, sizeof(buffer), 4);
+    E_SyscallSubmit(0);
+    return 0;
+  }
+};
+
+class SyscallExit : public ::testing::Test {
+protected:
+  NetworkSystem system;
+  std::shared_ptr<Host> host;
+  MockTransport::Counters counters;
+
+  virtual void SetUp() {
+    host = system.addModule<Host>("Host", system);
+    host->addHostModule<MockTransport>(*host, counters);
+    // Submissions take time to reach the interface, so the process exits
+    // before its last batch is delivered.
+    Host::CPUModel model;
+    model.perSyscall = TimeUtil::makeTime(1, TimeUtil::USEC);
+    host->setCPUModel(model);
+  }
+
+  virtual void TearDown() { host.reset(); }
+};
+
+TEST_F(SyscallExit, UndeliveredBatchIsDropped) {
+  host->launchApplication(host->addApplication<ExitingApp>(*host, false));
+  system.run(0);
+
+  EXPECT_EQ(counters.reads, 0);
+  EXPECT_EQ(system.getPendingMessageCount(), 0);
+  EXPECT_EQ(host->cleanUp(), 0);
+}
+
+TEST_F(SyscallExit, LateCompletionIsIgnored) {
+  host->launchApplication(host->addApplication<ExitingApp>(*host, true));
+  system.run(0);
+
+  EXPECT_EQ(counters.accepts, 1);
+  EXPECT_EQ(counters.reads, 1);
+  EXPECT_EQ(counters.lateReturns, 1);
+  EXPECT_EQ(host->cleanUp(), 0);
+}
+
+TEST_F(SyscallExit, NextProcessRunsAfterExit) {
+  host->launchApplication(host->addApplication<ExitingApp>(*host, true));
+  host->launchApplication(host->addApplication<ExitingApp>(*host, true));
+  system.run(0);
+
+  EXPECT_EQ(counters.accepts, 2);
+  EXPECT_EQ(counters.reads, 2);
+  EXPECT_EQ(counters.lateReturns, 2);
+
+  // A process started after the others exited gets its own completions.
+  host->launchApplication(host->addApplication<ExitingApp>(*host, true));
+  system.run(0);
+  EXPECT_EQ(counters.reads, 3);
+  EXPECT_EQ(host->cleanUp(), 0);
+}
@@ -0,0 +1,155 @@
+/*
+ * testvectorio.cpp
+ */
+
+#include "testenv.hpp"
+
+// Stands in for TCP with only READ and WRITE: READ returns up to
+// readLimit bytes of a fixed stream, and WRITE records what it is given.
+class MockStream : public SystemCallInterface {
+public:
+  class Record {
+  public:
+    std::vector<SystemCall> calls;
+    std::string written;
+  };
+
+  MockStream(Host &host, Record &record, bool vectored = false)
+      : SystemCallInterface(AF_INET, IPPROTO_TCP, host), record(record),
+        vectored(vectored) {}
+
+  static constexpr size_t readLimit = 11;
+  static constexpr const char *stream = "hello, world";
+
+protected:
+  Record &record;
+  bool vectored;
+
+  virtual void systemCallback(UUID syscallUUID, int pid,
+                              const SystemCallParameter &param) final {
+    record.calls.push_back(param.syscallNumber);
+    switch (param.syscallNumber) {
+    case SOCKET:
+      returnSystemCall(syscallUUID, createFileDescriptor(pid));
+      break;
+    case READ: {
+      size_t count =
+          std::min<size_t>(std::get<int>(param.params[2]), readLimit);
+      memcpy(std::get<void *>(param.params[1]), stream, count);
+      returnSystemCall(syscallUUID, (int)count);
+      break;
+    }
+    case WRITE: {
+      int count = std::get<int>(param.params[2]);
+      record.written.append((const char *)std::get<void *>(param.params[1]),
+                            count);
+      returnSystemCall(syscallUUID, count);
+      break;
+    }
+    default:
+      returnSystemCall(syscallUUID, -ENOSYS);
+      break;
+    }
+  }
+
+  virtual bool supportsSystemCall(SystemCall syscallNumber) const final {
+    return vectored || SystemCallInterface::supportsSystemCall(syscallNumber);
+  }
+};
+
+class VectorIO : public ::testing::Test {
+protected:
+  NetworkSystem system;
+  std::shared_ptr<Host> host;
+  MockStream::Record record;
+
+  void run(ScriptApp::Script script, bool vectored = false) {
+    host = system.addModule<Host>("Host", system);
+    host->addHostModule<MockStream>(*host, record, vectored);
+    runScript(system, *host, script);
+  }
+
+  virtual void TearDown() { host.reset(); }
+};
+
+using SystemCall = SystemCallInterface::SystemCall;
+
+TEST_F(VectorIO, WritevIsGathered) {
+  run([](ScriptApp &app) {
+    int fd = app.socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    char a[] = "abc", b[] = "", c[] = "defgh";
+    struct iovec iov[3] = {{a, 3}, {b, 0}, {c, 5}};
+    EXPECT_EQ(app.writev(fd, iov, 3), 8);
+    EXPECT_EQ(app.writev(fd, iov, 0), 0);
+    EXPECT_EQ(app.writev(fd, iov, -1), -EINVAL);
+  });
+  EXPECT_EQ(record.written, "abcdefgh");
+  std::vector<SystemCall> expected = {SystemCall::SOCKET, SystemCall::WRITE,
+                                      SystemCall::WRITE};
+  EXPECT_EQ(record.calls, expected);
+}
+
+TEST_F(VectorIO, ReadvIsScattered) {
+  run([](ScriptApp &app) {
+    int fd = app.socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    char a[4] = {}, b[3] = {}, c[10] = {};
+    struct iovec iov[3] = {{a, 4}, {b, 3}, {c, 10}};
+    // A single READ, which returns 11 bytes, fills the vectors in order.
+    EXPECT_EQ(app.readv(fd, iov, 3), 11);
+    EXPECT_EQ(std::string(a, 4), "hell");
+    EXPECT_EQ(std::string(b, 3), "o, ");
+    EXPECT_EQ(std::string(c, 4), "worl");
+    EXPECT_EQ(c[4], 0);
+  });
+  std::vector<SystemCall> expected = {SystemCall::SOCKET, SystemCall::READ};
+  EXPECT_EQ(record.calls, expected);
+}
+
+TEST_F(VectorIO, SendfileWritesFromBuffer) {
+  run([](ScriptApp &app) {
+    int fd = app.socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    int bfd = app.buffer_create("0123456789", 10);
+    off_t offset = 3;
+    EXPECT_EQ(app.sendfile(fd, bfd, &offset, 4), 4);
+    EXPECT_EQ(offset, 7);
+    EXPECT_EQ(app.sendfile(fd, bfd, &offset, 100), 3);
+    EXPECT_EQ(offset, 10);
+    EXPECT_EQ(app.sendfile(fd, bfd, &offset, 100), 0);
+    EXPECT_EQ(app.sendfile(fd, fd, nullptr, 1), -EBADF);
+    EXPECT_EQ(app.close(bfd), 0);
+    EXPECT_EQ(app.sendfile(fd, bfd, nullptr, 1), -EBADF);
+  });
+  EXPECT_EQ(record.written, "3456789");
+}
+
+TEST_F(VectorIO, BufferDescriptorOnlyFeedsSendfile) {
+  run([](ScriptApp &app) {
+    int bfd = app.buffer_create("data", 4);
+    char byte;
+    EXPECT_EQ(app.read(bfd, &byte, 1), -EBADF);
+    EXPECT_EQ(app.write(bfd, &byte, 1), -EBADF);
+    struct iovec iov = {&byte, 1};
+    EXPECT_EQ(app.readv(bfd, &iov, 1), -EBADF);
+    EXPECT_EQ(app.close(bfd), 0);
+
+    // Unknown descriptors fail the same way.
+    EXPECT_EQ(app.read(bfd, &byte, 1), -EBADF);
+    EXPECT_EQ(app.close(bfd), -EBADF);
+  });
+  EXPECT_TRUE(record.calls.empty());
+}
+
+TEST_F(VectorIO, SupportingInterfaceGetsCallsAsIssued) {
+  run(
+      [](ScriptApp &app) {
+        int fd = app.socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        char byte = 0;
+        struct iovec iov = {&byte, 1};
+        EXPECT_EQ(app.readv(fd, &iov, 1), -ENOSYS);
+        EXPECT_EQ(app.writev(fd, &iov, 1), -ENOSYS);
+      },
+      true);
+  std::vector<SystemCall> expected = {SystemCall::SOCKET, SystemCall::READV,
+                                      SystemCall::WRITEV};
+  EXPECT_EQ(record.calls, expected);
+}
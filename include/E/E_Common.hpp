@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <any>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cinttypes>
 #include <cmath>
@@ -25,6 +26,7 @@
 #include <ctime>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
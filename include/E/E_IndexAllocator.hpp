@@ -0,0 +1,194 @@
+/**
+ * @file   E_IndexAllocator.hpp
+ * @brief  Header for E::IndexBitmap and E::SlotMap
+ */
+
+#ifndef E_INDEXALLOCATOR_HPP_
+#define E_INDEXALLOCATOR_HPP_
+
+#include <E/E_Common.hpp>
+
+namespace E {
+
+/**
+ * @brief IndexBitmap allocates integers from [0, capacity), lowest free
+ * first (e.g. file descriptors).
+ *
+ * One bit marks each index, and a summary bit marks each full 64-bit
+ * word, so a search skips 4096 used indices per summary word.
+ */
+class IndexBitmap {
+public:
+  /**
+   * @param capacity Number of indices.
+   */
+  IndexBitmap(size_t capacity)
+      : capacity(capacity), words((capacity + 63) / 64, 0),
+        full((words.size() + 63) / 64, 0) {
+    assert(capacity > 0);
+    // Indices past the capacity are never free.
+    if (capacity % 64 != 0)
+      words.back() = ~0ULL << (capacity % 64);
+    updateSummary(words.size() - 1);
+  }
+
+  /**
+   * @param from Smallest acceptable index.
+   * @param wrap Whether to continue from 0 if no index >= from is free.
+   * @return Lowest free index at or after from, or nothing if none is free.
+   */
+  std::optional<size_t> findFree(size_t from = 0, bool wrap = false) const {
+    if (from < capacity) {
+      size_t word = from / 64;
+      uint64_t freeBits = ~words[word] & (~0ULL << (from % 64));
+      if (freeBits != 0)
+        return word * 64 + __builtin_ctzll(freeBits);
+      std::optional<size_t> next = findFreeWord(word + 1);
+      if (next.has_value())
+        return next.value() * 64 + __builtin_ctzll(~words[next.value()]);
+    }
+    if (wrap && from > 0)
+      return findFree(0, false);
+    return {};
+  }
+
+  /**
+   * @param index Index to check.
+   * @return Whether the index is allocated.
+   */
+  bool test(size_t index) const {
+    assert(index < capacity);
+    return (words[index / 64] >> (index % 64)) & 1;
+  }
+
+  /**
+   * @brief Mark an index allocated.
+   */
+  void set(size_t index) {
+    assert(index < capacity);
+    words[index / 64] |= 1ULL << (index % 64);
+    updateSummary(index / 64);
+  }
+
+  /**
+   * @brief Mark an index free.
+   */
+  void reset(size_t index) {
+    assert(index < capacity);
+    words[index / 64] &= ~(1ULL << (index % 64));
+    updateSummary(index / 64);
+  }
+
+private:
+  size_t capacity;
+  std::vector<uint64_t> words; // 1 = allocated
+  std::vector<uint64_t> full;  // 1 = word is full
+
+  void updateSummary(size_t word) {
+    if (words[word] == ~0ULL)
+      full[word / 64] |= 1ULL << (word % 64);
+    else
+      full[word / 64] &= ~(1ULL << (word % 64));
+  }
+
+  std::optional<size_t> findFreeWord(size_t from) const {
+    for (size_t k = from / 64; k < full.size(); k++) {
+      uint64_t notFull = ~full[k];
+      if (k == from / 64)
+        notFull &= ~0ULL << (from % 64);
+      if (notFull != 0) {
+        size_t word = k * 64 + __builtin_ctzll(notFull);
+        if (word < words.size())
+          return word;
+      }
+    }
+    return {};
+  }
+};
+
+/**
+ * @brief SlotMap stores values under generated keys with O(1) insertion,
+ * lookup and removal. A key is a slot index and the generation of the
+ * slot, so a removed key is never found again even if its slot is reused.
+ */
+template <typename T> class SlotMap {
+public:
+  using Key = uint64_t;
+
+  /**
+   * @param value Value to store.
+   * @return Key of the value.
+   */
+  Key insert(T value) {
+    uint32_t index;
+    if (freeSlots.empty()) {
+      index = (uint32_t)slots.size();
+      slots.emplace_back();
+    } else {
+      index = freeSlots.back();
+      freeSlots.pop_back();
+    }
+    Slot &slot = slots[index];
+    slot.value.emplace(std::move(value));
+    count++;
+    return ((Key)slot.generation << 32) | index;
+  }
+
+  /**
+   * @param key Key to look up.
+   * @return Value of the key, or null if it is not stored.
+   */
+  T *find(Key key) {
+    uint32_t index = (uint32_t)key;
+    if (index >= slots.size())
+      return nullptr;
+    Slot &slot = slots[index];
+    if (!slot.value.has_value() || slot.generation != (uint32_t)(key >> 32))
+      return nullptr;
+    return &slot.value.value();
+  }
+
+  /**
+   * @param key Key to remove.
+   * @return Whether the key was stored.
+   */
+  bool erase(Key key) {
+    if (find(key) == nullptr)
+      return false;
+    uint32_t index = (uint32_t)key;
+    slots[index].value.reset();
+    slots[index].generation++;
+    freeSlots.push_back(index);
+    count--;
+    return true;
+  }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  /**
+   * @brief Call visitor(key, value) for every stored value.
+   */
+  template <typename Visitor> void forEach(Visitor &&visitor) const {
+    for (size_t k = 0; k < slots.size(); k++) {
+      const Slot &slot = slots[k];
+      if (slot.value.has_value())
+        visitor(((Key)slot.generation << 32) | k, slot.value.value());
+    }
+  }
+
+private:
+  class Slot {
+  public:
+    uint32_t generation = 0;
+    std::optional<T> value;
+  };
+
+  std::vector<Slot> slots;
+  std::vector<uint32_t> freeSlots;
+  size_t count = 0;
+};
+
+} // namespace E
+
+#endif /* E_INDEXALLOCATOR_HPP_ */
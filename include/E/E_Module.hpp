@@ -49,6 +49,12 @@ public:
   public:
     MessageBase() {}
     virtual ~MessageBase() {}
+
+    /**
+     * @brief Overridden by TimerModule::TimerEvent, so that a Host can fire
+     * timers before it looks at the type of other messages.
+     */
+    virtual bool isTimerEvent() const { return false; }
   };
 
   class EmptyMessage : public MessageBase {
@@ -196,6 +202,33 @@ protected:
    */
   virtual bool cancelMessage(UUID messageID) final;
 
+  /**
+   * @brief Reserve the position a Message sent to self with no delay would
+   * take in the total ordering, without sending it.
+   * A Module may use reserved positions to handle its own zero-delay work
+   * inline, in the same order as if it were sent as Messages.
+   *
+   * @return Reserved ID (it cannot be cancelled).
+   * @see hasMessageBefore, sendReservedMessageSelf
+   */
+  UUID reserveMessageID();
+
+  /**
+   * @param messageID ID reserved at the current time.
+   * @return Whether the System has something to deliver (a Message or a
+   * ready Runnable) before the reserved position.
+   */
+  bool hasMessageBefore(UUID messageID);
+
+  /**
+   * @brief Send a Message to self at the current time, in a reserved
+   * position of the total ordering.
+   * @param message Message to be sent.
+   * @param messageID ID reserved at the current time by reserveMessageID.
+   * @return messageID
+   */
+  UUID sendReservedMessageSelf(Module::Message message, UUID messageID);
+
   friend class System;
 };
 
@@ -62,11 +62,19 @@ protected:
   ModuleID lookupModuleID(Module &module);
   std::unordered_map<ModuleID, std::shared_ptr<Module>> registeredModule;
 
+  /**
+   * @brief Drop every pending message and destroy every registered Module.
+   * The destructor does this, but a derived System may do it earlier to
+   * inspect what is left afterwards.
+   */
+  void destroyModules();
+
 private:
   std::priority_queue<TimerContainer, std::vector<TimerContainer>,
                       TimerContainerLess>
       timerQueue;
   std::unordered_map<UUID, TimerContainer> activeTimer;
+  Size cancelledCount = 0; // cancelled messages still in activeTimer
   std::unordered_set<UUID> activeUUID;
   UUID currentUUID = 0;
 
@@ -75,7 +83,11 @@ private:
   bool isRegistered(const ModuleID moduleID);
   UUID sendMessage(const ModuleID from, const ModuleID to,
                    Module::Message message, Time timeAfter);
+  UUID sendReservedMessage(const ModuleID from, const ModuleID to,
+                           Module::Message message, UUID messageID);
   bool cancelMessage(UUID messageID);
+  UUID reserveMessageID();
+  bool hasMessageBefore(UUID messageID);
 
 public:
   /**
@@ -98,6 +110,12 @@ public:
    */
   Time getCurrentTime();
 
+  /**
+   * @return Returns the number of messages which are not delivered yet
+   * (including the message being delivered now, but not cancelled ones).
+   */
+  Size getPendingMessageCount();
+
   /**
    * @brief Register a Runnable interface to this System.
    *
@@ -139,6 +157,10 @@ public:
   friend UUID Module::sendMessage(const ModuleID to, Module::Message message,
                                   Time timeAfter);
   friend bool Module::cancelMessage(UUID timer);
+  friend UUID Module::reserveMessageID();
+  friend bool Module::hasMessageBefore(UUID messageID);
+  friend UUID Module::sendReservedMessageSelf(Module::Message message,
+                                              UUID messageID);
 };
 
 /**
@@ -0,0 +1,320 @@
+/**
+ * @file   E_HeaderView.hpp
+ * @brief  Typed views of protocol headers stored in a Packet.
+ * E::EthernetHeaderView, E::IPv4HeaderView, E::TCPHeaderView,
+ * E::UDPHeaderView and their read-only Const variants.
+ */
+
+#ifndef E_HEADERVIEW_HPP_
+#define E_HEADERVIEW_HPP_
+
+#include <E/E_Common.hpp>
+#include <E/Networking/E_NetworkUtil.hpp>
+#include <E/Networking/E_Packet.hpp>
+
+namespace E {
+
+/**
+ * @brief HeaderViewBase gives direct access to a fixed-size header inside
+ * a Packet. Multi-byte fields are converted from/to network byte order.
+ *
+ * A view is invalid (see isValid) if the header is out of range or not
+ * stored contiguously. A writable view (Byte = uint8_t) makes the Packet
+ * buffer private first; a read-only view (Byte = const uint8_t) never
+ * copies. A view must not be used after its Packet is modified by other
+ * means.
+ *
+ * @note Setters can only be used on writable views.
+ */
+template <typename Byte> class HeaderViewBase {
+public:
+  using PacketType =
+      std::conditional_t<std::is_const_v<Byte>, const Packet, Packet>;
+
+  /**
+   * @return Whether the header is accessible.
+   */
+  bool isValid() const { return data != nullptr; }
+  explicit operator bool() const { return isValid(); }
+
+  /**
+   * @return First byte of the header.
+   */
+  Byte *getData() const { return data; }
+
+protected:
+  HeaderViewBase(PacketType &packet, size_t offset, size_t length)
+      : data(locate(packet, offset, length)) {}
+
+  uint8_t load8(size_t at) const { return data[at]; }
+  uint16_t load16(size_t at) const {
+    return (uint16_t)((data[at] << 8) | data[at + 1]);
+  }
+  uint32_t load32(size_t at) const {
+    return ((uint32_t)data[at] << 24) | ((uint32_t)data[at + 1] << 16) |
+           ((uint32_t)data[at + 2] << 8) | (uint32_t)data[at + 3];
+  }
+  template <size_t N> std::array<uint8_t, N> loadArray(size_t at) const {
+    std::array<uint8_t, N> value;
+    memcpy(value.data(), data + at, N);
+    return value;
+  }
+
+  void store8(size_t at, uint8_t value) { data[at] = value; }
+  void store16(size_t at, uint16_t value) {
+    data[at] = value >> 8;
+    data[at + 1] = value & 0xFF;
+  }
+  void store32(size_t at, uint32_t value) {
+    data[at] = value >> 24;
+    data[at + 1] = (value >> 16) & 0xFF;
+    data[at + 2] = (value >> 8) & 0xFF;
+    data[at + 3] = value & 0xFF;
+  }
+  template <size_t N>
+  void storeArray(size_t at, const std::array<uint8_t, N> &value) {
+    memcpy(data + at, value.data(), N);
+  }
+
+private:
+  static const uint8_t *locate(const Packet &packet, size_t offset,
+                               size_t length) {
+    return packet.peek(offset, length);
+  }
+  static uint8_t *locate(Packet &packet, size_t offset, size_t length) {
+    return packet.map(offset, length);
+  }
+
+  Byte *data;
+};
+
+/**
+ * @brief Ethernet II header (14 bytes).
+ */
+template <typename Byte>
+class EthernetHeaderViewBase : public HeaderViewBase<Byte> {
+public:
+  static constexpr size_t SIZE = 14;
+  static constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+  static constexpr uint16_t ETHERTYPE_IPV6 = 0x86DD;
+
+  EthernetHeaderViewBase(typename HeaderViewBase<Byte>::PacketType &packet,
+                         size_t offset = 0)
+      : HeaderViewBase<Byte>(packet, offset, SIZE) {}
+
+  mac_t getDestination() const { return this->template loadArray<6>(0); }
+  mac_t getSource() const { return this->template loadArray<6>(6); }
+  uint16_t getEtherType() const { return this->load16(12); }
+
+  void setDestination(const mac_t &mac) { this->storeArray(0, mac); }
+  void setSource(const mac_t &mac) { this->storeArray(6, mac); }
+  void setEtherType(uint16_t type) { this->store16(12, type); }
+};
+
+/**
+ * @brief IPv4 header without options (20 bytes).
+ */
+template <typename Byte>
+class IPv4HeaderViewBase : public HeaderViewBase<Byte> {
+public:
+  static constexpr size_t SIZE = 20;
+
+  IPv4HeaderViewBase(typename HeaderViewBase<Byte>::PacketType &packet,
+                     size_t offset = EthernetHeaderViewBase<Byte>::SIZE)
+      : HeaderViewBase<Byte>(packet, offset, SIZE) {}
+
+  uint8_t getVersion() const { return this->load8(0) >> 4; }
+  uint8_t getHeaderLength() const { return this->load8(0) & 0x0F; }
+  uint8_t getTypeOfService() const { return this->load8(1); }
+  uint16_t getTotalLength() const { return this->load16(2); }
+  uint16_t getIdentification() const { return this->load16(4); }
+  uint16_t getFragment() const { return this->load16(6); }
+  uint8_t getTTL() const { return this->load8(8); }
+  uint8_t getProtocol() const { return this->load8(9); }
+  uint16_t getChecksum() const { return this->load16(10); }
+  ipv4_t getSource() const { return this->template loadArray<4>(12); }
+  ipv4_t getDestination() const { return this->template loadArray<4>(16); }
+
+  void setVersionAndHeaderLength(uint8_t version, uint8_t length) {
+    this->store8(0, (version << 4) | (length & 0x0F));
+  }
+  void setTypeOfService(uint8_t tos) { this->store8(1, tos); }
+  void setTotalLength(uint16_t length) { this->store16(2, length); }
+  void setIdentification(uint16_t id) { this->store16(4, id); }
+  void setFragment(uint16_t fragment) { this->store16(6, fragment); }
+  void setTTL(uint8_t ttl) { this->store8(8, ttl); }
+  void setProtocol(uint8_t protocol) { this->store8(9, protocol); }
+  void setChecksum(uint16_t checksum) { this->store16(10, checksum); }
+  void setSource(const ipv4_t &ip) { this->storeArray(12, ip); }
+  void setDestination(const ipv4_t &ip) { this->storeArray(16, ip); }
+
+  /*
+   * The update setters also adjust the header checksum incrementally
+   * (RFC 1624), e.g. for TTL decrement, ECN marking or address rewrite.
+   * Transport checksums covering the addresses are not adjusted.
+   */
+  void updateTypeOfService(uint8_t tos) {
+    updateWord(0, (this->load8(0) << 8) | tos);
+  }
+  void updateTTL(uint8_t ttl) { updateWord(8, (ttl << 8) | this->load8(9)); }
+  void updateSource(const ipv4_t &ip) {
+    updateWord(12, (ip[0] << 8) | ip[1]);
+    updateWord(14, (ip[2] << 8) | ip[3]);
+  }
+  void updateDestination(const ipv4_t &ip) {
+    updateWord(16, (ip[0] << 8) | ip[1]);
+    updateWord(18, (ip[2] << 8) | ip[3]);
+  }
+
+private:
+  void updateWord(size_t at, uint16_t value) {
+    uint16_t checksum =
+        NetworkUtil::update_sum16(this->load16(10), this->load16(at), value);
+    this->store16(at, value);
+    this->store16(10, checksum);
+  }
+};
+
+/**
+ * @brief TCP header without options (20 bytes).
+ */
+template <typename Byte>
+class TCPHeaderViewBase : public HeaderViewBase<Byte> {
+public:
+  static constexpr size_t SIZE = 20;
+
+  TCPHeaderViewBase(typename HeaderViewBase<Byte>::PacketType &packet,
+                    size_t offset = EthernetHeaderViewBase<Byte>::SIZE +
+                                    IPv4HeaderViewBase<Byte>::SIZE)
+      : HeaderViewBase<Byte>(packet, offset, SIZE) {}
+
+  uint16_t getSourcePort() const { return this->load16(0); }
+  uint16_t getDestinationPort() const { return this->load16(2); }
+  uint32_t getSequence() const { return this->load32(4); }
+  uint32_t getAcknowledgement() const { return this->load32(8); }
+  uint8_t getDataOffset() const { return this->load8(12) >> 4; }
+  uint8_t getFlags() const { return this->load8(13); }
+  uint16_t getWindow() const { return this->load16(14); }
+  uint16_t getChecksum() const { return this->load16(16); }
+  uint16_t getUrgentPointer() const { return this->load16(18); }
+
+  void setSourcePort(uint16_t port) { this->store16(0, port); }
+  void setDestinationPort(uint16_t port) { this->store16(2, port); }
+  void setSequence(uint32_t seq) { this->store32(4, seq); }
+  void setAcknowledgement(uint32_t ack) { this->store32(8, ack); }
+  void setDataOffset(uint8_t words) { this->store8(12, words << 4); }
+  void setFlags(uint8_t flags) { this->store8(13, flags); }
+  void setWindow(uint16_t window) { this->store16(14, window); }
+  void setChecksum(uint16_t checksum) { this->store16(16, checksum); }
+  void setUrgentPointer(uint16_t pointer) { this->store16(18, pointer); }
+};
+
+/**
+ * @brief UDP header (8 bytes).
+ */
+template <typename Byte>
+class UDPHeaderViewBase : public HeaderViewBase<Byte> {
+public:
+  static constexpr size_t SIZE = 8;
+
+  UDPHeaderViewBase(typename HeaderViewBase<Byte>::PacketType &packet,
+                    size_t offset = EthernetHeaderViewBase<Byte>::SIZE +
+                                    IPv4HeaderViewBase<Byte>::SIZE)
+      : HeaderViewBase<Byte>(packet, offset, SIZE) {}
+
+  uint16_t getSourcePort() const { return this->load16(0); }
+  uint16_t getDestinationPort() const { return this->load16(2); }
+  uint16_t getLength() const { return this->load16(4); }
+  uint16_t getChecksum() const { return this->load16(6); }
+
+  void setSourcePort(uint16_t port) { this->store16(0, port); }
+  void setDestinationPort(uint16_t port) { this->store16(2, port); }
+  void setLength(uint16_t length) { this->store16(4, length); }
+  void setChecksum(uint16_t checksum) { this->store16(6, checksum); }
+};
+
+using EthernetHeaderView = EthernetHeaderViewBase<uint8_t>;
+using ConstEthernetHeaderView = EthernetHeaderViewBase<const uint8_t>;
+using IPv4HeaderView = IPv4HeaderViewBase<uint8_t>;
+using ConstIPv4HeaderView = IPv4HeaderViewBase<const uint8_t>;
+using TCPHeaderView = TCPHeaderViewBase<uint8_t>;
+using ConstTCPHeaderView = TCPHeaderViewBase<const uint8_t>;
+using UDPHeaderView = UDPHeaderViewBase<uint8_t>;
+using ConstUDPHeaderView = UDPHeaderViewBase<const uint8_t>;
+
+/**
+ * @brief Fill the link layer fields of the PacketMetadata from the Ethernet
+ * header at offset 0, unless they are filled already.
+ * @param packet Packet to parse.
+ * @return Whether the link layer fields are available.
+ */
+inline bool parseEthernetHeader(Packet &packet) {
+  PacketMetadata &metadata = packet.getMetadata();
+  if (metadata.has(PacketMetadata::LINK_PARSED))
+    return true;
+
+  ConstEthernetHeaderView ethernet(packet);
+  if (!ethernet)
+    return false;
+  metadata.sourceMAC = ethernet.getSource();
+  metadata.destinationMAC = ethernet.getDestination();
+  metadata.etherType = ethernet.getEtherType();
+  metadata.flags |= PacketMetadata::LINK_PARSED;
+  packet.setLayerOffset(Packet::LINK_LAYER, 0);
+  return true;
+}
+
+/**
+ * @brief Compute the checksums marked in PacketMetadata::offload and clear
+ * the marks, as a NIC does on transmit. The IPv4 header is expected right
+ * after an Ethernet header.
+ * @param packet Packet to complete.
+ */
+inline void completeChecksums(Packet &packet) {
+  PacketMetadata &metadata = packet.getMetadata();
+  if (metadata.offload == 0)
+    return;
+
+  IPv4HeaderView ip(packet);
+  if (ip && metadata.has(PacketMetadata::IPV4_CHECKSUM)) {
+    ip.setChecksum(0);
+    ip.setChecksum(~NetworkUtil::one_sum(ip.getData(), ip.SIZE));
+  }
+
+  size_t header_length = ip ? ip.getHeaderLength() * 4 : 0;
+  if (ip && metadata.has(PacketMetadata::TCP_CHECKSUM) &&
+      ip.getTotalLength() >= header_length) {
+    uint32_t source, destination;
+    memcpy(&source, ip.getSource().data(), sizeof(source));
+    memcpy(&destination, ip.getDestination().data(), sizeof(destination));
+
+    size_t tcp_start = EthernetHeaderView::SIZE + header_length;
+    size_t tcp_length = ip.getTotalLength() - header_length;
+    size_t header_size = TCPHeaderView::SIZE;
+    TCPHeaderView tcp(packet, tcp_start);
+    if (tcp && tcp_length >= header_size &&
+        tcp_start + tcp_length <= packet.getSize()) {
+      tcp.setChecksum(0);
+      // Sum the rest in place, as the payload may be in segments.
+      uint16_t payload_sum = 0;
+      size_t position = 0;
+      packet.visitData(tcp_start + header_size, tcp_length - header_size,
+                       [&](const char *data, size_t length) {
+                         uint16_t part = NetworkUtil::one_sum(
+                             (const uint8_t *)data, length);
+                         payload_sum = NetworkUtil::add_sum(payload_sum, part,
+                                                            position);
+                         position += length;
+                       });
+      tcp.setChecksum(~NetworkUtil::tcp_sum(source, destination,
+                                            tcp.getData(), header_size,
+                                            payload_sum,
+                                            tcp_length - header_size));
+    }
+  }
+  metadata.offload = 0;
+}
+
+} // namespace E
+
+#endif /* E_HEADERVIEW_HPP_ */
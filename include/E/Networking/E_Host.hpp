@@ -10,6 +10,7 @@
 #define E_HOST_HPP_
 
 #include <E/E_Common.hpp>
+#include <E/E_IndexAllocator.hpp>
 #include <E/E_Module.hpp>
 #include <E/Networking/E_NetworkLog.hpp>
 #include <E/Networking/E_Networking.hpp>
@@ -18,13 +19,43 @@
 #include <E/Networking/E_TimerModule.hpp>
 #include <E/Networking/E_Wire.hpp>
 extern "C" {
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 }
 
 namespace E {
 class Host;
 class TCPApplication;
 
+/**
+ * @brief ModuleHandle is the interned name of a HostModule within a Host.
+ * Handles are resolved once (see HostModule::getModuleHandle), so passing
+ * Packets by handle involves no string allocation, hashing or comparison.
+ *
+ * A handle can be resolved before the named module is added to the Host.
+ */
+class ModuleHandle {
+public:
+  constexpr ModuleHandle() : index(INVALID) {}
+  constexpr explicit ModuleHandle(uint32_t index) : index(index) {}
+
+  bool isValid() const { return index != INVALID; }
+  uint32_t getIndex() const { return index; }
+
+  bool operator==(const ModuleHandle &other) const {
+    return index == other.index;
+  }
+  bool operator!=(const ModuleHandle &other) const {
+    return index != other.index;
+  }
+
+private:
+  static constexpr uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+  uint32_t index;
+};
+
 /**
  * @brief HostModule is an interface for classes
  * which is registered to a certain Host.
@@ -53,6 +84,11 @@ public:
    */
   virtual std::string getHostModuleName() final;
 
+  /**
+   * @return My handle in the registered Host.
+   */
+  ModuleHandle getHostModuleHandle() const;
+
   /**
    * @brief This function is automatically called by Host just before the
    * simulation begins. You can override this function if needed.
@@ -94,6 +130,41 @@ protected:
   virtual void sendPacket(std::string toModule, Packet &&packet) final;
   void sendPacket(std::string toModule, const Packet &packet);
 
+  /**
+   * @brief Handle-based variant of packetArrived, which Host calls.
+   * By default, it calls packetArrived with the name of the sender.
+   * Override it to avoid string handling per Packet.
+   * Modules built against E 3.3.8 (such as prebuilt solutions) only
+   * receive packetArrived with the name.
+   *
+   * @param fromModule Handle of the HostModule who sent this packet
+   * (Host::HOST_HANDLE for packets from the ports).
+   * @param packet Received packet.
+   */
+  virtual void packetArrived(ModuleHandle fromModule, Packet &&packet);
+
+  /**
+   * @brief Handle-based variant of sendPacket.
+   * @param toModule Handle of the destination HostModule.
+   * @param packet Packet to be sent.
+   */
+  void sendPacket(ModuleHandle toModule, Packet &&packet);
+
+  /**
+   * @brief Intern a HostModule name. Resolve handles once (e.g. in the
+   * constructor) and keep them. "Host" is Host::HOST_HANDLE and "Loopback"
+   * is Host::LOOPBACK_HANDLE.
+   * @param name Name of a HostModule.
+   * @return Handle of the name.
+   */
+  ModuleHandle getModuleHandle(const std::string &name);
+
+  /**
+   * @param handle Handle of a HostModule.
+   * @return Name of the HostModule.
+   */
+  const std::string &getModuleHandleName(ModuleHandle handle);
+
   /**
    * @return Returns current virtual clock of the System.
    */
@@ -114,6 +185,19 @@ protected:
    */
   size_t getPortCount();
 
+  /**
+   * @return Whether checksums are offloaded on this Host.
+   * @see Host::setChecksumOffload
+   */
+  bool getChecksumOffload();
+
+  /**
+   * @param ip IPv4 address.
+   * @return Whether packets to the address take the loopback port.
+   * @see Host::setLoopbackPort
+   */
+  bool isLoopbackAddress(const ipv4_t &ip);
+
   /**
    * @brief Prints log with specified log level and format.
    * NetworkLog::print_log prints logs specified in log level parameter.
@@ -167,15 +251,65 @@ public:
 
     NSLEEP,
     GETTIMEOFDAY,
+
+    // Handled by the Host
+    FCNTL,
+    POLL,
+    EPOLL_CREATE,
+    EPOLL_CTL,  // epfd, operation, extra: fd, EpollEvent *
+    EPOLL_WAIT, // epfd, EpollEvent *, extra: int maxevents, int timeout
+
+    READV,         // fd, struct iovec *, int iovcnt
+    WRITEV,        // fd, struct iovec *, int iovcnt
+    BUFFER_CREATE, // handled by the Host
+    SENDFILE,      // fd, buffer fd, extra: uint64_t offset, int count
+  };
+
+  /**
+   * @brief Immutable contents of a buffer descriptor (see BUFFER_CREATE).
+   * Transport modules attach it to Packets by reference
+   * (Packet::appendPayload), so SENDFILE copies no payload.
+   */
+  class SharedBuffer {
+  public:
+    PacketBuffer buffer;
+    size_t length;
+  };
+
+  /**
+   * @brief Operations of EPOLL_CTL (values of EPOLL_CTL_ADD, ... on Linux).
+   */
+  enum EpollOperation {
+    EPOLL_ADD = 1,
+    EPOLL_DEL = 2,
+    EPOLL_MOD = 3,
+  };
+
+  /**
+   * @brief Event record of EPOLL_CTL and EPOLL_WAIT (struct epoll_event).
+   * Events are poll(2) bits (POLLIN, POLLOUT, POLLERR, POLLHUP), which have
+   * the values of the corresponding EPOLL* bits on Linux.
+   * Only level-triggered notification is supported.
+   */
+  class EpollEvent {
+  public:
+    uint32_t events;
+    uint64_t data;
   };
 
   class SystemCallParameter {
   public:
+    using Parameter = std::variant<void *, int8_t, int16_t, int32_t, int64_t,
+                                   uint8_t, uint16_t, uint32_t, uint64_t>;
+
+    /**
+     * @brief Parameters of a call which takes more than max_param ("extra"
+     * above). Like socketcall(2), the last parameter points to them.
+     */
+    using ExtraParameters = std::array<Parameter, 2>;
+
     enum SystemCall syscallNumber;
-    std::array<std::variant<void *, int8_t, int16_t, int32_t, int64_t, uint8_t,
-                            uint16_t, uint32_t, uint64_t>,
-               max_param>
-        params;
+    std::array<Parameter, max_param> params;
   };
 
 protected:
@@ -247,6 +381,56 @@ protected:
    */
   virtual void removeFileDescriptor(int processID, int fd) final;
 
+  /**
+   * @brief Report which events are ready on a file descriptor.
+   * This drives POLL and EPOLL_WAIT: blocked callers waiting for any of
+   * the events are woken. Readiness is level-triggered, so report it
+   * again whenever it changes (e.g. POLLIN when data arrives, and 0 when
+   * the receive buffer is drained).
+   *
+   * @param processID PID of the file descriptor owner.
+   * @param fd File descriptor.
+   * @param events Ready events (POLLIN, POLLOUT, POLLERR, POLLHUP).
+   * @note You cannot override this function.
+   */
+  virtual void setFileDescriptorEvents(int processID, int fd,
+                                       short events) final;
+
+  /**
+   * @brief Whether O_NONBLOCK is set on a file descriptor (see FCNTL).
+   * A system call on such a descriptor which cannot complete immediately
+   * should return -EAGAIN instead of blocking.
+   *
+   * @param processID PID of the file descriptor owner.
+   * @param fd File descriptor.
+   * @return Whether the descriptor is non-blocking.
+   * @note You cannot override this function.
+   */
+  virtual bool isNonBlocking(int processID, int fd) final;
+
+  /**
+   * @brief Look up a buffer descriptor, e.g. the source of SENDFILE.
+   *
+   * @param processID PID of the file descriptor owner.
+   * @param fd File descriptor.
+   * @return Buffer contents, or nothing if fd is not a buffer descriptor.
+   * @note You cannot override this function.
+   */
+  virtual std::optional<SharedBuffer> getSharedBuffer(int processID,
+                                                      int fd) final;
+
+  /**
+   * @brief Whether systemCallback handles a system call itself.
+   * Unless it does, the Host runs READV and WRITEV as a single READ or
+   * WRITE through a bounce buffer, and SENDFILE as a WRITE from the
+   * buffer descriptor, so an interface only needs READ and WRITE.
+   *
+   * @param syscallNumber System call.
+   * @return Whether the system call is delivered as issued. By default,
+   * false for READV, WRITEV and SENDFILE.
+   */
+  virtual bool supportsSystemCall(SystemCall syscallNumber) const;
+
   friend class Host;
 
 private:
@@ -266,6 +450,24 @@ public:
   SystemCallApplication(Host &host);
   virtual ~SystemCallApplication();
 
+  /**
+   * @brief A system call queued by E_SyscallPrepare.
+   */
+  class Submission {
+  public:
+    SystemCallInterface::SystemCallParameter param;
+    uint64_t userData;
+  };
+
+  /**
+   * @brief Result of a system call issued by E_SyscallSubmit.
+   */
+  class Completion {
+  public:
+    uint64_t userData;
+    int result;
+  };
+
 protected:
   /**
    * @brief Standard C++11 thread is automatically launched,
@@ -285,6 +487,47 @@ protected:
 
   virtual void returnSyscall(int retVal) final;
 
+  /**
+   * @brief Queue a system call without issuing it.
+   * Queued calls are issued together by E_SyscallSubmit, and their results
+   * are collected with E_SyscallReap, in the manner of io_uring.
+   *
+   * @param param Parameters for system call.
+   * @param userData Value returned with the completion of this call.
+   * @note You cannot override this function.
+   */
+  virtual void
+  E_SyscallPrepare(const SystemCallInterface::SystemCallParameter &param,
+                   uint64_t userData) final;
+
+  /**
+   * @brief Issue every queued system call in a single handoff to the Host.
+   * The calls run concurrently; none of them blocks the application.
+   *
+   * @param waitFor Block until at least this many completions are ready
+   * (limited to the number of calls in flight). With 0, the application
+   * keeps running and the calls are issued when it next blocks.
+   * @return Number of system calls issued.
+   * @note You cannot override this function.
+   */
+  virtual size_t E_SyscallSubmit(size_t waitFor = 0) final;
+
+  /**
+   * @brief Collect results of submitted system calls, oldest first.
+   * This never blocks.
+   *
+   * @param completions Array to fill.
+   * @param count Size of the array.
+   * @return Number of completions stored.
+   * @note You cannot override this function.
+   */
+  virtual size_t E_SyscallReap(Completion *completions, size_t count) final;
+
+  /**
+   * @return Number of submitted system calls which are not reaped yet.
+   */
+  size_t getSyscallsInFlight() const;
+
   /**
    * @brief This does a role of int main(int argc, char** argv, char** env).
    * The main functions of multiple applications run in parallel.
@@ -301,12 +544,18 @@ protected:
 private:
   virtual void main() override final;
   virtual void finalizeApplication(int returnValue) final;
+  void completeSyscall(uint64_t userData, int result);
 
 private:
   Host &host;
   int pid;
   int syscallRet = 0;
 
+  std::vector<Submission> submissions;
+  std::deque<Completion> completions;
+  size_t syscallsInFlight = 0;   // submitted, not completed
+  size_t completionsWanted = 0; // nonzero while blocked in E_SyscallSubmit
+
   friend class Host;
   friend class TCPApplication;
 };
@@ -320,11 +569,67 @@ public:
   using Protocol = int;
   using Namespace = std::pair<Domain, Protocol>;
 
+  /**
+   * @brief Processing costs charged to the CPU of a Host.
+   * @see Host::setCPUModel
+   */
+  class CPUModel {
+  public:
+    /**
+     * @brief Cost of each packet received from or sent to a port.
+     */
+    Time perPacket = 0;
+    /**
+     * @brief Additional cost of those packets, in nanoseconds per byte.
+     */
+    Real perByte = 0;
+    /**
+     * @brief Cost of each system call, including each call submitted
+     * with SystemCallApplication::E_SyscallSubmit.
+     */
+    Time perSyscall = 0;
+    /**
+     * @brief Number of cores. Packets are spread over the cores by a
+     * symmetric hash of their 5-tuple (receive-side scaling), and system
+     * calls run on the core of the calling process. The HostModules do
+     * not run on any core (see Host::setCPUModel).
+     * @see Host::setProcessAffinity
+     */
+    size_t cores = 1;
+  };
+
+  /**
+   * @brief Built-in loopback port of a Host.
+   * @see Host::setLoopbackPort
+   */
+  class LoopbackPort {
+  public:
+    /**
+     * @brief Time a packet takes to come back.
+     */
+    Time delay = 0;
+    /**
+     * @brief Largest IPv4 packet the port carries, in bytes.
+     */
+    Size mtu = 65536;
+  };
+
 private:
   static constexpr int MAX_FD = 65536;
   static constexpr int MAX_PID = 65536;
+  static constexpr int MAX_IOV = 1024; // IOV_MAX on Linux
 
-  class DefaultSystemCall : public SystemCallInterface, public TimerModule {
+  // Timer payload of NSLEEP, and of POLL and EPOLL_WAIT timeouts
+  class SyscallTimer {
+  public:
+    SystemCallInterface::SystemCall syscallNumber;
+    UUID syscallUUID;
+    int pid;
+    int epfd; // EPOLL_WAIT only
+  };
+
+  class DefaultSystemCall : public SystemCallInterface,
+                            public TypedTimerModule<SyscallTimer> {
   public:
     DefaultSystemCall(Host &host);
     virtual ~DefaultSystemCall();
@@ -332,26 +637,133 @@ private:
   protected:
     virtual void systemCallback(UUID syscallUUID, int pid,
                                 const SystemCallParameter &param) final;
-    virtual void timerCallback(std::any payload) final;
+    virtual void timerCallback(SyscallTimer &timer) final;
+
+    friend class Host;
+  };
+
+  class FileDescriptorState {
+  public:
+    int flags = 0;           // O_NONBLOCK
+    short events = 0;        // ready events
+    std::vector<int> epolls; // epoll instances watching this descriptor
+  };
+
+  // Blocked POLL or EPOLL_WAIT
+  class PollWaiter {
+  public:
+    UUID syscallUUID;
+    void *events; // struct pollfd or EpollEvent array
+    size_t count;
+    std::optional<UUID> timer;
+  };
+
+  class EpollInstance {
+  public:
+    std::map<int, SystemCallInterface::EpollEvent> interest;
+    std::set<int> ready;
+    int cursor = 0; // ready descriptors are reported round-robin from here
+    std::list<PollWaiter> waiters;
+  };
+
+  // READV, WRITEV or SENDFILE run as a READ or WRITE
+  class EmulatedSyscall {
+  public:
+    std::vector<uint8_t> bounce;       // READV and WRITEV
+    const struct iovec *iov = nullptr; // READV, scattered on return
+    int iovcnt = 0;
+    SystemCallInterface::SharedBuffer source; // SENDFILE, kept alive
+  };
+
+  class PendingSyscall {
+  public:
+    int pid;
+    std::optional<uint64_t> userData; // only for E_SyscallSubmit
+    std::unique_ptr<EmulatedSyscall> emulated;
   };
 
   class ProcessInfo {
   public:
     std::shared_ptr<SystemCallApplication> application;
     std::map<int, Namespace> fdToDomain;
+    IndexBitmap fdBitmap = IndexBitmap(MAX_FD);
+    std::unordered_map<int, FileDescriptorState> fdState;
+    std::unordered_map<int, EpollInstance> epolls;
+    std::list<PollWaiter> pollWaiters;
+    std::unordered_map<int, SystemCallInterface::SharedBuffer> buffers;
+    std::optional<size_t> core;         // affinity
+    std::unordered_set<UUID> submitted; // undelivered SubmittedSyscall
   };
 
+  /*
+   * These members keep their E 3.3.8 offsets, which the inline
+   * addHostModule of prebuilt solutions was compiled with.
+   */
   int pidStart;
-  UUID syscallIDStart;
+  DefaultSystemCall *defaultSystemCall;
   bool running;
+  bool checksumOffload;
   NetworkSystem &networkSystem;
-
   std::unordered_map<Namespace, std::shared_ptr<SystemCallInterface>>
       interfaceMap;
   std::unordered_map<std::string, std::shared_ptr<HostModule>> hostModuleMap;
   std::unordered_map<std::string, std::shared_ptr<TimerModule>> timerModuleMap;
+
+  IndexBitmap pidBitmap;
+
+  /*
+   * Virtual CPU (see Host::setCPUModel). Work on each core is served in
+   * arrival order: each item starts when the core becomes free and takes
+   * effect when its cost has been paid.
+   */
+  std::optional<CPUModel> cpuModel;
+  std::vector<Time> coreBusyUntil;
+  std::vector<Time> coreBusyTime; // total cost charged since cpuModelSince
+  Time cpuModelSince;
+  Time chargeCPU(size_t core, Time cost);
+  Time packetCost(const Packet &packet) const;
+  size_t selectCore(const Packet &packet) const;
+  size_t selectCore(int pid);
+  void receivePacket(Packet &&packet);
+
+  std::optional<LoopbackPort> loopbackPort;
+  void loopBack(ModuleHandle fromModule, Packet &&packet);
+
+  std::unordered_map<std::string, ModuleHandle> handleMap;
+  std::vector<std::string> handleNames;
+  std::vector<HostModule *> handleModules; // null until the module is created
+  std::unordered_map<const HostModule *, ModuleHandle> moduleHandles;
+  ModuleHandle ethernetHandle;
+
+  /*
+   * Modules and interfaces added by the addHostModule of E 3.3.8 (prebuilt
+   * solutions) lack the virtual functions added since: such modules get
+   * packetArrived by name, and such interfaces get no supportsSystemCall.
+   */
+  std::vector<bool> namedDelivery; // by handle
+  std::unordered_set<const SystemCallInterface *> currentInterfaces;
+
+  class PacketHop {
+  public:
+    ModuleHandle from;
+    ModuleHandle to;
+    Packet packet;
+    UUID messageID; // position in the System message order
+  };
+
+  /*
+   * Packets passed between HostModules take no time. Instead of one
+   * PacketPass message per hop, hops are queued here and delivered by a
+   * single PacketPass, run to completion. Each hop reserves the position
+   * its own message would have had, and delivery pauses whenever the
+   * System has something to deliver before it, so the order of events is
+   * unchanged.
+   */
+  std::deque<PacketHop> hopQueue;
+  bool hopQueueScheduled;
+  void deliverPacketHops();
   std::unordered_map<int, ProcessInfo> processInfoMap;
-  std::unordered_map<UUID, int> syscallMap; // to PID
+  SlotMap<PendingSyscall> syscallMap;
 
   virtual Module::Message messageReceived(const ModuleID from,
                                           Module::MessageBase &message) final;
@@ -365,6 +777,27 @@ public:
   virtual ~Host();
   virtual int cleanUp(void) final;
   virtual bool isRunning(void) final;
+
+  /**
+   * @brief Handle of the "Host" pseudo module: packets sent to it leave
+   * through a port, and packets from the ports come from it.
+   */
+  static constexpr ModuleHandle HOST_HANDLE = ModuleHandle(0);
+
+  /**
+   * @brief Handle of the "Loopback" pseudo module: packets sent to it
+   * return to their sender through the loopback port, coming from it.
+   * @see Host::setLoopbackPort
+   */
+  static constexpr ModuleHandle LOOPBACK_HANDLE = ModuleHandle(1);
+
+  /**
+   * @brief Intern a HostModule name.
+   * @see HostModule::getModuleHandle
+   */
+  ModuleHandle getModuleHandle(const std::string &name);
+  const std::string &getModuleHandleName(ModuleHandle handle) const;
+
   template <typename T, typename... Args> void addHostModule(Args &&...args) {
     static_assert(std::is_base_of<HostModule, T>::value ||
                   std::is_base_of<TimerModule, T>::value ||
@@ -376,6 +809,7 @@ public:
       bool ret = hostModuleMap.insert({hostModuleName, hostModule}).second;
       (void)ret;
       assert(ret);
+      namedDelivery[hostModule->getHostModuleHandle().getIndex()] = false;
     }
 
     if constexpr (std::is_base_of<TimerModule, T>::value) {
@@ -393,6 +827,7 @@ public:
               .second;
       (void)ret;
       assert(ret);
+      currentInterfaces.insert(hostModule.get());
     }
   }
   template <typename T, typename... Args> int addApplication(Args &&...args) {
@@ -409,6 +844,95 @@ public:
   std::any diagnoseHostModule(const char *name, std::any param);
   Size getWireSpeed(int port_num);
 
+  /**
+   * @brief Let the NIC compute checksums, as real NICs do.
+   * Outgoing packets are marked in PacketMetadata::offload instead of
+   * carrying a computed checksum, and receivers trust the mark. An element
+   * that modifies a marked packet in flight (e.g. an unreliable Switch)
+   * fills the checksums first, so corruption is still detected exactly.
+   * PCAP files get the checksums filled in (see completeChecksums).
+   *
+   * IPv4 honors this flag. TCP implementations may check
+   * HostModule::getChecksumOffload and set
+   * PacketMetadata::TCP_CHECKSUM themselves.
+   *
+   * @param enable Whether to offload checksums (default: false).
+   */
+  void setChecksumOffload(bool enable);
+  bool getChecksumOffload() const;
+
+  /**
+   * @brief Give this Host a virtual CPU which charges the costs of the
+   * model. Packets from the ports, packets to the ports and system calls
+   * are served one at a time per core, in arrival order. Each takes effect
+   * (reaches the Ethernet module, the wire or the SystemCallInterface)
+   * only after its core has spent its cost on it, so work queues up while
+   * the core is busy.
+   *
+   * Only those are charged. The HostModules (Ethernet, IPv4, TCP, ...)
+   * and timers run at no cost, so per-packet protocol processing has to
+   * be folded into perPacket and perByte.
+   *
+   * Both directions of a flow hash to the same core, like symmetric RSS
+   * on a multi-queue NIC, so a few heavy flows can overload single cores
+   * of an otherwise idle CPU.
+   *
+   * Without a model (the default), a Host has unlimited CPU and all of
+   * this work takes no time.
+   *
+   * @param model CPU costs, or nothing to remove the CPU model.
+   * Utilization accounting restarts.
+   */
+  void setCPUModel(std::optional<CPUModel> model);
+  std::optional<CPUModel> getCPUModel() const;
+
+  /**
+   * @brief Pin the system calls of a process to a core.
+   * Without affinity, a process runs on core (pid % cores).
+   *
+   * @param pid Process to pin.
+   * @param core Core index (taken modulo the number of cores).
+   */
+  void setProcessAffinity(int pid, size_t core);
+
+  /**
+   * @return Fraction of time the CPU has been busy since
+   * Host::setCPUModel, averaged over the cores (0 without a model).
+   * Register it with NetworkSystem::addProbe to sample it over time.
+   */
+  Real getCPUUtilization();
+
+  /**
+   * @param core Core index.
+   * @return Fraction of time one core has been busy since
+   * Host::setCPUModel (0 without a model).
+   */
+  Real getCoreUtilization(size_t core);
+
+  /**
+   * @brief Configure the loopback port. Once it is set, IPv4 sends packets
+   * for 127.0.0.0/8 and for the addresses of this Host to
+   * Host::LOOPBACK_HANDLE, so they come back to it without passing
+   * Ethernet, the ports and the network. Like the loopback interface of
+   * Linux, it skips the IPv4 checksum and uses zero MAC addresses.
+   * With a CPU model, a looped packet is charged once.
+   *
+   * There is no loopback port by default, so such packets go through the
+   * ports and the topology like any other.
+   *
+   * @param port Loopback port (e.g. LoopbackPort{} for no delay and a
+   * 64 KiB MTU), or nothing to disable it.
+   */
+  void setLoopbackPort(std::optional<LoopbackPort> port);
+  std::optional<LoopbackPort> getLoopbackPort() const;
+
+  /**
+   * @param ip IPv4 address.
+   * @return Whether packets to the address take the loopback port (false
+   * if it is disabled).
+   */
+  bool isLoopbackAddress(const ipv4_t &ip);
+
   class Syscall : public Module::MessageBase {
   public:
     int pid;
@@ -418,6 +942,17 @@ public:
     ~Syscall() override {}
   };
 
+  // A system call of E_SyscallSubmit
+  class SubmittedSyscall : public Module::MessageBase {
+  public:
+    int pid;
+    SystemCallApplication::Submission submission;
+    UUID messageID = 0; // see ProcessInfo::submitted
+    SubmittedSyscall(int pid, SystemCallApplication::Submission &&submission)
+        : pid(pid), submission(std::move(submission)) {}
+    ~SubmittedSyscall() override {}
+  };
+
   // Application Return
   class Return : public Module::MessageBase {
   public:
@@ -426,22 +961,34 @@ public:
     Return(int pid, int returnValue) : pid(pid), returnValue(returnValue) {}
     ~Return() override {}
   };
-  class PacketPass : public Module::MessageBase {
+  // A packet from a port, delivered when the CPU has processed it
+  class Ingress : public Module::MessageBase {
+  public:
+    Packet packet;
+    Ingress(Packet &&packet) : packet(std::move(packet)) {}
+    ~Ingress() override {}
+  };
+  // A packet on the loopback port, returned to its sender on arrival
+  class Loopback : public Module::MessageBase {
   public:
-    std::optional<std::string> from;
-    std::optional<std::string> to;
+    ModuleHandle to;
     Packet packet;
-    PacketPass(std::optional<std::string> from, std::optional<std::string> to,
-               Packet &&packet)
-        : from(from), to(to), packet(packet) {}
-    PacketPass(Packet &&packet) : from({}), to({}), packet(packet) {}
+    Loopback(ModuleHandle to, Packet &&packet)
+        : to(to), packet(std::move(packet)) {}
+    ~Loopback() override {}
+  };
+  // Delivers the queued packet passes (see Host::hopQueue)
+  class PacketPass : public Module::MessageBase {
+  public:
+    PacketPass() {}
     ~PacketPass() override {}
   };
   class Timer : public Module::MessageBase {
   public:
-    std::string from;
+    TimerModule *module;
     std::any payload;
-    Timer(std::string from, std::any payload) : from(from), payload(payload) {}
+    Timer(TimerModule *module, std::any &&payload)
+        : module(module), payload(std::move(payload)) {}
     ~Timer() override {}
   };
 
@@ -450,35 +997,83 @@ public:
 private:
   virtual void sendPacketToModule(std::optional<std::string> fromModule,
                                   std::string toModule, Packet &&packet) final;
+  void sendPacketToModule(ModuleHandle fromModule, ModuleHandle toModule,
+                          Packet &&packet);
 
-  virtual UUID addTimer(std::string fromModule, std::any payload,
+  virtual UUID addTimer(TimerModule *module, std::any payload,
                         Time timeAfter) final;
+  UUID addTimer(std::unique_ptr<TimerModule::TimerEvent> event,
+                Time timeAfter);
   virtual void cancelTimer(UUID key) final;
   virtual UUID
   issueSystemCall(int pid,
                   const SystemCallInterface::SystemCallParameter &param) final;
+  void issueSystemCalls(
+      int pid, std::vector<SystemCallApplication::Submission> &&submissions);
+  // Drop the system calls of an exiting process
+  void exitSystemCalls(int pid);
+  void dispatchSystemCall(int pid,
+                          const SystemCallInterface::SystemCallParameter &param,
+                          std::optional<uint64_t> userData);
+  std::optional<int>
+  emulateSystemCall(int pid, SystemCallInterface::SystemCallParameter &param,
+                    PendingSyscall &pending);
 
   virtual void returnSystemCall(UUID syscallUUID, int val) final;
   virtual int createFileDescriptor(int domain, int protocol,
                                    int processID) final;
   virtual void removeFileDescriptor(int processID, int fd) final;
+  void setFileDescriptorEvents(int processID, int fd, short events);
+  bool isNonBlocking(int processID, int fd);
+
+  int fileControl(int pid, int fd, int command, int argument);
+  void pollFileDescriptors(UUID syscallUUID, int pid, struct pollfd *fds,
+                           size_t count, int timeout);
+  int epollCreate(int pid);
+  int epollControl(int pid, int epfd, int operation, int fd,
+                   const SystemCallInterface::EpollEvent *event);
+  void epollWait(UUID syscallUUID, int pid, int epfd,
+                 SystemCallInterface::EpollEvent *events, int maxEvents,
+                 int timeout);
+  int epollClose(int pid, int epfd);
+  int bufferCreate(int pid, const void *data, size_t length);
+  std::optional<SystemCallInterface::SharedBuffer> getSharedBuffer(int pid,
+                                                                   int fd);
+  void pollTimedOut(const SyscallTimer &timer);
+  size_t collectPollEvents(ProcessInfo &procInfo, struct pollfd *fds,
+                           size_t count);
+  size_t collectEpollEvents(ProcessInfo &procInfo, EpollInstance &instance,
+                            SystemCallInterface::EpollEvent *events,
+                            size_t count);
+  void updateEpollReady(ProcessInfo &procInfo, int fd);
   virtual int registerProcess(std::shared_ptr<SystemCallApplication> app) final;
   virtual void exitProcess(int pid, int returnValue) final;
 
   friend HostModule::HostModule(std::string name, Host &host);
   friend HostModule::~HostModule();
+  friend ModuleHandle HostModule::getHostModuleHandle() const;
   friend void HostModule::sendPacket(std::string toModule, Packet &&packet);
+  friend void HostModule::sendPacket(ModuleHandle toModule, Packet &&packet);
 
   friend SystemCallInterface::SystemCallInterface(int domain, int protocol,
                                                   Host &host);
   friend void SystemCallInterface::returnSystemCall(UUID syscallUUID, int val);
   friend int SystemCallInterface::createFileDescriptor(int processID);
   friend void SystemCallInterface::removeFileDescriptor(int processID, int fd);
+  friend void SystemCallInterface::setFileDescriptorEvents(int processID,
+                                                         int fd, short events);
+  friend bool SystemCallInterface::isNonBlocking(int processID, int fd);
+  friend std::optional<SystemCallInterface::SharedBuffer>
+  SystemCallInterface::getSharedBuffer(int processID, int fd);
 
   friend int SystemCallApplication::E_Syscall(
       const SystemCallInterface::SystemCallParameter &param);
+  friend size_t SystemCallApplication::E_SyscallSubmit(size_t waitFor);
   friend void SystemCallApplication::finalizeApplication(int returnValue);
   friend UUID TimerModule::addTimer(std::any payload, Time timeAfter);
+  friend UUID
+  TimerModule::addTimerEvent(std::unique_ptr<TimerModule::TimerEvent> event,
+                             Time timeAfter);
   friend void TimerModule::cancelTimer(UUID key);
 };
 
@@ -38,12 +38,23 @@ private:
   Size snaplen;
   LinearDistribution rand_dist;
 
+  void writePCAP(const Packet &packet, Time time);
+
 protected:
   std::unordered_map<ModuleID, Time> nextAvailable;
   std::unordered_map<ModuleID, std::list<Packet>> outputQueue;
   Size bps;
   Size max_queue_length;
+  bool batching;
   virtual void packetArrived(const ModuleID inWireID, Packet &&packet) = 0;
+
+  /**
+   * @brief Process packets which arrived together through one Wire.
+   * The default implementation calls packetArrived for each packet in order.
+   * @param inWireID Wire the packets arrived from.
+   * @param batch Arrived packets.
+   */
+  virtual void packetsArrived(const ModuleID inWireID, PacketBatch &&batch);
   virtual void packetSent(const ModuleID wireID, Packet &&packet) {
     (void)wireID;
     (void)packet;
@@ -84,6 +95,13 @@ public:
    * Zero indicates infinite queue.
    */
   virtual void setQueueSize(Size max_queue_length) final;
+
+  /**
+   * @param batching Let a Link without transmission delay send its queued
+   * packets as one batch (default). Otherwise it sends one packet per event,
+   * with the same delivery order, drops and PCAP records.
+   */
+  virtual void setBatching(bool batching) final;
 };
 
 } // namespace E
@@ -18,14 +18,63 @@ private:
   virtual ~NetworkUtil();
 
 public:
+  /**
+   * Implementations of one_sum.
+   * All of them return bit-identical results.
+   */
+  enum class SumKernel {
+    BYTEWISE, // one byte at a time (reference)
+    WORD64,   // 64-bit words, portable
+    SSE2,     // x86 only
+    AVX2,     // x86 only
+  };
+
   /**
    * Calculate checksum once
+   * (ones' complement sum of big-endian 16-bit words, not complemented).
+   * The fastest kernel supported by the CPU is selected at run time.
    * @param buffer Buffer to calculate.
    * @param size Size of buffer.
    * @return Checksum
    */
   static uint16_t one_sum(const uint8_t *buffer, size_t size);
 
+  /**
+   * Calculate checksum once with a specific kernel.
+   * @param buffer Buffer to calculate.
+   * @param size Size of buffer.
+   * @param kernel Kernel to use. It must be supported (see has_sum_kernel).
+   * @return Checksum
+   */
+  static uint16_t one_sum(const uint8_t *buffer, size_t size,
+                          SumKernel kernel);
+
+  /**
+   * @param kernel Kernel to check.
+   * @return Whether the kernel can run on this CPU.
+   */
+  static bool has_sum_kernel(SumKernel kernel);
+
+  /**
+   * Copy a buffer and calculate its checksum in the same pass
+   * (the source is read only once).
+   * @param destination Destination buffer (must not overlap source).
+   * @param source Buffer to copy and calculate.
+   * @param size Size of buffer.
+   * @return Checksum, as one_sum(source, size)
+   */
+  static uint16_t copy_and_sum(uint8_t *destination, const uint8_t *source,
+                               size_t size);
+
+  /**
+   * Add the checksum of a part to the checksum of the preceding data.
+   * @param sum Checksum of the preceding data
+   * @param part Checksum of the part (as one_sum)
+   * @param offset Offset of the part from the start of the data
+   * @return Checksum of both
+   */
+  static uint16_t add_sum(uint16_t sum, uint16_t part, size_t offset);
+
   /**
    * Calculate TCP checksum.
    * @param source Source address (pseudo header)
@@ -38,6 +87,62 @@ public:
   static uint16_t tcp_sum(uint32_t source, uint32_t dest,
                           const uint8_t *tcp_seg, size_t length);
 
+  /**
+   * Calculate TCP checksum from the header and the checksum of the payload
+   * (e.g. from Packet::writeDataAndSum), without reading the payload.
+   * @param source Source address (pseudo header)
+   * @param dest  Destination address (pseudo header)
+   * @param tcp_header TCP header including options
+   * @param header_length Length of the TCP header
+   * @param payload_sum Checksum of the payload (as one_sum)
+   * @param payload_length Length of the payload
+   * @return Checksum, as tcp_sum over the whole segment
+   */
+  static uint16_t tcp_sum(uint32_t source, uint32_t dest,
+                          const uint8_t *tcp_header, size_t header_length,
+                          uint16_t payload_sum, size_t payload_length);
+
+  /**
+   * Adjust a checksum for a change of one 16-bit word (RFC 1624, Eqn. 3).
+   * The word must be 16-bit aligned within the checksummed data.
+   * @param checksum Checksum field as stored (complemented, host byte order)
+   * @param old_value Previous value of the word (host byte order)
+   * @param new_value New value of the word (host byte order)
+   * @return Updated checksum field
+   */
+  static uint16_t update_sum16(uint16_t checksum, uint16_t old_value,
+                               uint16_t new_value);
+
+  /**
+   * Adjust a checksum for a change of one 32-bit field (e.g. an address).
+   * @see update_sum16
+   */
+  static uint16_t update_sum32(uint16_t checksum, uint32_t old_value,
+                               uint32_t new_value);
+
+  /**
+   * Hash a flow 5-tuple.
+   * @param source Source address
+   * @param dest Destination address
+   * @param protocol IP protocol number
+   * @param source_port Source port (host byte order)
+   * @param dest_port Destination port (host byte order)
+   * @return Hash value (not symmetric in source and destination)
+   */
+  static uint32_t flow_hash(const ipv4_t &source, const ipv4_t &dest,
+                            uint8_t protocol, uint16_t source_port,
+                            uint16_t dest_port);
+
+  /**
+   * Hash a flow 5-tuple so that both directions of a flow have the same
+   * hash (like symmetric RSS of a multi-queue NIC).
+   * @see flow_hash
+   */
+  static uint32_t symmetric_flow_hash(const ipv4_t &source,
+                                      const ipv4_t &dest, uint8_t protocol,
+                                      uint16_t source_port,
+                                      uint16_t dest_port);
+
   /**
    * Converts a uint64_t variable to std::array
    * @param N Size of array
@@ -12,6 +12,10 @@
 #include <E/E_Module.hpp>
 #include <E/E_System.hpp>
 #include <E/Networking/E_NetworkLog.hpp>
+#include <E/Networking/E_Packet.hpp>
+#include <E/Networking/E_PacketPool.hpp>
+#include <E/Networking/E_PacketTracker.hpp>
+#include <E/Networking/E_Sampler.hpp>
 #include <E/Networking/E_Wire.hpp>
 
 namespace E {
@@ -28,6 +32,12 @@ public:
 
 protected:
   std::vector<ModuleID> ports;
+
+  /**
+   * @brief Reset the per-node context of a packet received from a Wire and
+   * record its ingress port and time in the PacketMetadata.
+   */
+  void stampIngress(const ModuleID wireID, Packet &packet);
 };
 
 /**
@@ -37,10 +47,21 @@ protected:
  */
 class NetworkSystem : public System, private NetworkLog {
 private:
-  UUID packetUUIDStart;
-  std::unordered_set<UUID> packetUUIDSet;
-  void freePacketUUID(UUID uuid);
-  UUID allocatePacketUUID();
+  std::shared_ptr<Sampler> sampler;
+  std::shared_ptr<PacketPool> packetPool;
+  Packet::Statistics packetStatistics;
+#ifdef ENABLE_PACKET_TRACE
+  std::unique_ptr<PacketTracker> packetTracker;
+  friend class PacketTracker;
+#endif
+
+  /*
+   * NetworkSystems alive on this thread, oldest first. The newest one has
+   * its PacketPool, Packet::Statistics and PacketTracker installed, even if
+   * the systems are destroyed out of order.
+   */
+  static thread_local std::vector<NetworkSystem *> installed;
+  void install();
 
 public:
   NetworkSystem();
@@ -51,6 +72,40 @@ public:
           bool limit_speed = true);
 
   Size getWireSpeed(const ModuleID moduleID);
+
+  /**
+   * @return The built-in Sampler of this NetworkSystem.
+   * It is created on first use and flushed when the NetworkSystem is
+   * destroyed.
+   */
+  Sampler &getSampler();
+
+  /**
+   * @brief Register a probe sampled periodically in virtual time.
+   * @see Sampler::addProbe
+   */
+  Sampler::ProbeID addProbe(std::string name, Time interval,
+                            Sampler::Probe probe);
+
+  /**
+   * @return Hit/miss statistics of the PacketPool owned by this
+   * NetworkSystem.
+   */
+  PacketPool::Statistics getPacketPoolStatistics();
+
+  /**
+   * @return Packet copies, clones and copied bytes counted while this
+   * NetworkSystem was installed.
+   */
+  Packet::Statistics getPacketStatistics();
+
+#ifdef ENABLE_PACKET_TRACE
+  /**
+   * @return Packet lifecycle tracker of this NetworkSystem. It exists only
+   * if the library is built with packet tracking (see PACKET_TRACE).
+   */
+  PacketTracker *getPacketTracker();
+#endif
 };
 
 } // namespace E
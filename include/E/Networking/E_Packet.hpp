@@ -10,32 +10,181 @@
 
 #include <E/E_Common.hpp>
 #include <E/E_Module.hpp>
+#include <E/Networking/E_PacketPool.hpp>
 
 namespace E {
 class NetworkSystem;
 
+/**
+ * @brief Header fields parsed once per node and carried with a Packet,
+ * so later layers need not parse the headers again.
+ *
+ * Link::messageReceived and Host::messageReceived reset it (see
+ * Packet::clearContext) and record the ingress port and time.
+ * Ethernet, IPv4 and Switch fill the parsed fields. Header offsets are
+ * kept as layer marks (see Packet::setLayerOffset).
+ *
+ * A field is only meaningful if the flag of its layer is set.
+ * Multi-byte fields are in host byte order.
+ *
+ * @note Writing to parsed header fields does not update the metadata.
+ * A module rewriting them must call Packet::clearContext.
+ *
+ * The offload field is an exception: it describes the packet content
+ * rather than the current node, so it is kept by clearContext.
+ */
+class PacketMetadata {
+public:
+  enum Flag : uint8_t {
+    LINK_PARSED = 1 << 0,
+    NETWORK_PARSED = 1 << 1,
+    TRANSPORT_PARSED = 1 << 2,
+  };
+
+  /**
+   * @brief Checksums left to the NIC (see Host::setChecksumOffload).
+   */
+  enum Offload : uint8_t {
+    IPV4_CHECKSUM = 1 << 0,
+    TCP_CHECKSUM = 1 << 1,
+  };
+
+  bool has(Flag flag) const { return (flags & flag) != 0; }
+  bool has(Offload checksum) const { return (offload & checksum) != 0; }
+
+  uint8_t flags = 0;
+
+  /* LINK_PARSED */
+  mac_t sourceMAC = {};
+  mac_t destinationMAC = {};
+  uint16_t etherType = 0;
+
+  /* NETWORK_PARSED */
+  ipv4_t sourceIP = {};
+  ipv4_t destinationIP = {};
+  uint8_t protocol = 0;
+
+  /* TRANSPORT_PARSED (TCP and UDP) */
+  uint16_t sourcePort = 0;
+  uint16_t destinationPort = 0;
+
+  /**
+   * @brief Hash of the 5-tuple (ports are zero unless TRANSPORT_PARSED).
+   * @see NetworkUtil::flow_hash
+   */
+  uint32_t flowHash = 0;
+
+  /**
+   * @brief Port index of the node the packet arrived at (-1 if unknown).
+   */
+  int ingressPort = -1;
+
+  /**
+   * @brief Time the packet arrived at the current node.
+   */
+  Time ingressTime = 0;
+
+  /**
+   * @brief Checksum fields which are not computed. A receiver may trust
+   * such a checksum without validating it.
+   * @see completeChecksums
+   */
+  uint8_t offload = 0;
+};
+
 /**
  * @brief This class abstracts a packet.
  * You cannot directly allocate/deallocate Packet.
  * Also you cannot directly access the internal buffer.
  * Use access functions.
  *
+ * The internal buffer is reference counted and shared by copies and clones.
+ * It is copied only when a Packet writes to (or resizes) a shared buffer.
+ *
+ * Packet data may be preceded by headroom and followed by tailroom,
+ * so headers can be prepended (push) or stripped (pull) without moving data.
+ * Every offset used by access functions is relative to the current start of
+ * the packet data.
+ *
+ * Payload may also be attached by reference (Packet::appendPayload) as a
+ * chain of read-only segments following the linear part. Access functions
+ * see the linear part and the segments as one contiguous byte range.
+ *
+ * A Packet, including its headroom, is smaller than 4 GiB.
  */
 class Packet : public Module::MessageBase {
+public:
+  /**
+   * @brief Layers that can be marked with Packet::setLayerOffset.
+   */
+  enum Layer {
+    LINK_LAYER,
+    NETWORK_LAYER,
+    TRANSPORT_LAYER,
+    LAYER_COUNT,
+  };
+
+  /**
+   * @brief Copy accounting of Packets handled by one System.
+   * @see NetworkSystem::getPacketStatistics
+   */
+  class Statistics {
+  public:
+    /**
+     * @brief Packets copied by the copy constructor or copy assignment.
+     */
+    Size copies = 0;
+    /**
+     * @brief Packets cloned by Packet::clone.
+     */
+    Size clones = 0;
+    /**
+     * @brief Bytes copied because a shared buffer was written, or because
+     * a buffer was grown or linearized.
+     */
+    Size copiedBytes = 0;
+  };
+
+  /**
+   * @brief Install the Statistics updated by Packets of the calling thread.
+   * @param statistics Statistics to update (may be null).
+   * @return Previously installed Statistics.
+   */
+  static Statistics *installStatistics(Statistics *statistics);
+
 private:
-  Packet(UUID uuid, size_t size);
-  std::vector<char> buffer;
+  Packet(UUID uuid, size_t size, size_t headroom, bool zero);
+  Packet(const Packet &other, UUID uuid);
 
+  /*
+   * A Packet keeps the size of an E 3.3.8 Packet, which prebuilt
+   * solutions allocate themselves. Per-node state and payload segments
+   * live in a Context, allocated when first needed.
+   */
+  class Context;
+  class Segment;
+  PacketBuffer buffer;
+  uint32_t head;
+  uint32_t length;
+  Context *context;
   UUID packetID;
 
-  static std::unordered_set<UUID> packetUUIDSet;
-  static UUID packetUUIDStart;
+  Context &getContext();
+  void unshare();
+  void unshare(Segment &segment);
+  void grow(size_t headroom, size_t tailroom);
+  size_t write(size_t offset, const void *data, size_t length, uint16_t *sum);
+
+  static thread_local Statistics *statistics;
+  static void countCopiedBytes(size_t bytes);
+
+  static std::atomic<UUID> packetUUIDNext;
   static UUID allocatePacketUUID();
-  static void freePacketUUID(UUID uuid);
 
 public:
   /**
    * Copy constructor. (Copied packet has same UUID)
+   * The buffer is shared until one of them is modified.
    * @param other Packet to copy.
    */
   Packet(const Packet &other);
@@ -63,10 +212,19 @@ public:
    */
   Packet(size_t size);
 
+  /**
+   * @param size Packet size.
+   * @param headroom Free space reserved in front of the packet data.
+   * @param zero Zero the packet data. Pass false only if every byte will be
+   * written, since recycled storage keeps the contents of an old packet.
+   */
+  Packet(size_t size, size_t headroom, bool zero = true);
+
   ~Packet() override;
 
   /**
    * Clone packet (Cloned packet has a different UUID)
+   * The buffer is shared until one of them is modified.
    * @return Cloned packet.
    */
   Packet clone() const;
@@ -80,6 +238,22 @@ public:
    */
   size_t writeData(size_t offset, const void *data, size_t length);
 
+  /**
+   * @brief Write data and add its checksum to a running checksum, reading
+   * the data only once (see NetworkUtil::copy_and_sum).
+   * Start with sum = 0 and pass the result to NetworkUtil::tcp_sum with the
+   * payload length. The byte order of each part is taken from its packet
+   * offset, so the summed data must start at an even offset (a TCP payload
+   * after Ethernet, IPv4 and TCP headers does).
+   * @param offset Start write skipping first n bytes of the given buffer.
+   * @param data Data to be written in this packet.
+   * @param length Length of data to be written.
+   * @param sum Running checksum (as NetworkUtil::one_sum) to update.
+   * @return Actual written bytes.
+   */
+  size_t writeDataAndSum(size_t offset, const void *data, size_t length,
+                         uint16_t &sum);
+
   /**
    * @param offset Start read skipping first n bytes of the internal buffer.
    * @param data Destination of the packet content.
@@ -88,6 +262,74 @@ public:
    */
   size_t readData(size_t offset, void *data, size_t length) const;
 
+  /**
+   * @brief Direct read-only access to packet content.
+   * @param offset Start of the bytes.
+   * @param length Number of bytes.
+   * @return Pointer to the bytes, or null if they are out of range or not
+   * stored contiguously in the linear part.
+   */
+  const uint8_t *peek(size_t offset, size_t length) const;
+
+  /**
+   * @brief Direct writable access to packet content.
+   * A shared buffer is copied first, as with writeData.
+   * @see peek
+   */
+  uint8_t *map(size_t offset, size_t length);
+
+  /**
+   * @brief Write a 16-bit field and adjust the checksum covering it
+   * (RFC 1624), without summing the whole header again.
+   * The field must be 16-bit aligned relative to the start of the
+   * checksummed data.
+   * @param offset Start of the field.
+   * @param value New value (host byte order, stored in network byte order).
+   * @param checksumOffset Start of the checksum field.
+   * @return False if either field is out of range or not stored
+   * contiguously (nothing is written).
+   */
+  bool updateField16(size_t offset, uint16_t value, size_t checksumOffset);
+
+  /**
+   * @brief Write a 32-bit field and adjust the checksum covering it.
+   * @see updateField16
+   */
+  bool updateField32(size_t offset, uint32_t value, size_t checksumOffset);
+
+  /**
+   * @brief Visit packet content in place, one contiguous piece at a time
+   * (the linear part, then each payload segment).
+   * @param offset Start visit skipping first n bytes.
+   * @param length Length of data to be visited.
+   * @param visitor Called with each piece and its length.
+   * @return Actual visited bytes.
+   */
+  size_t
+  visitData(size_t offset, size_t length,
+            const std::function<void(const char *, size_t)> &visitor) const;
+
+  /**
+   * @brief Attach payload by reference after the current packet data.
+   * The referenced bytes are not copied unless this Packet writes to them.
+   * @param buffer Buffer holding the payload (e.g. a sender-side buffer).
+   * @param offset Start of the payload in the buffer.
+   * @param length Length of the payload.
+   * @return New packet size.
+   */
+  size_t appendPayload(const PacketBuffer &buffer, size_t offset,
+                       size_t length);
+
+  /**
+   * @return Number of payload segments attached by reference.
+   */
+  size_t getSegmentCount() const;
+
+  /**
+   * @brief Copy every payload segment into the linear part.
+   */
+  void linearize();
+
   /**
    * @brief Change the size of this Packet
    * The size can be larger than the internal buffer.
@@ -101,11 +343,70 @@ public:
    */
   size_t getSize() const;
 
+  /**
+   * @brief Make sure that at least n bytes of headroom are available.
+   * The buffer is reallocated only if the current headroom is smaller.
+   * @param n Required headroom.
+   */
+  void reserve(size_t n);
+
+  /**
+   * @brief Prepend n bytes to the packet data (e.g. a new header).
+   * Offset 0 refers to the first pushed byte afterwards.
+   * This takes O(1) time unless the headroom is smaller than n.
+   * @param n Number of bytes to prepend.
+   * @return New packet size.
+   */
+  size_t push(size_t n);
+
+  /**
+   * @brief Strip n bytes from the front of the packet data (e.g. a parsed
+   * header). The stripped bytes are kept as headroom.
+   * @param n Number of bytes to strip.
+   * @return Actual stripped bytes.
+   */
+  size_t pull(size_t n);
+
+  /**
+   * @return Free space in front of the packet data.
+   */
+  size_t getHeadroom() const;
+
+  /**
+   * @return Free space after the packet data.
+   */
+  size_t getTailroom() const;
+
+  /**
+   * @brief Mark where the header of a layer starts.
+   * The mark follows the data, so it stays valid after push/pull.
+   * @param layer Layer to mark.
+   * @param offset Start of the header, relative to the packet data.
+   */
+  void setLayerOffset(Layer layer, size_t offset);
+
+  /**
+   * @param layer Layer to look up.
+   * @return Start of the header relative to the packet data, or nothing if
+   * the layer is not marked or its header was pulled.
+   */
+  std::optional<size_t> getLayerOffset(Layer layer) const;
+
   /**
    * @return Packet UUID.
    */
   UUID getUUID() const;
 
+  /**
+   * @return Parsed header fields of this Packet.
+   */
+  PacketMetadata &getMetadata();
+  const PacketMetadata &getMetadata() const;
+
+  /**
+   * @brief Forget per-node state: layer marks and metadata (except the
+   * offloaded checksums).
+   */
   void clearContext();
 
   friend class NetworkSystem;
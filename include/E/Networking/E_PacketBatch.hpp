@@ -0,0 +1,76 @@
+/**
+ * @file   E_PacketBatch.hpp
+ * @brief  Header for E::PacketBatch
+ */
+
+#ifndef E_PACKETBATCH_HPP_
+#define E_PACKETBATCH_HPP_
+
+#include <E/E_Common.hpp>
+#include <E/Networking/E_Packet.hpp>
+
+namespace E {
+
+/**
+ * @brief PacketBatch is a small fixed-capacity vector of Packets which
+ * arrive at the same time through the same port.
+ *
+ * Wire delivers simultaneous arrivals as one batch and Link processes it
+ * with Link::packetsArrived, so per-packet work (header parsing, table
+ * lookup, queueing) runs as tight loops over the batch. The ingress port is
+ * not stored; it is the sender of the message carrying the batch.
+ */
+class PacketBatch {
+public:
+  static constexpr size_t CAPACITY = 32;
+
+  /**
+   * @param arrivalTime Arrival time of every packet in the batch.
+   */
+  PacketBatch(Time arrivalTime = 0) : arrivalTime(arrivalTime), count(0) {}
+
+  /**
+   * @brief Append a packet.
+   * @param packet Packet to append.
+   * @return False if the batch is full (the packet is not moved).
+   */
+  bool push(Packet &&packet) {
+    if (full())
+      return false;
+    packets[count++].emplace(std::move(packet));
+    return true;
+  }
+
+  /**
+   * @brief Remove every packet.
+   */
+  void clear() {
+    for (size_t k = 0; k < count; k++)
+      packets[k].reset();
+    count = 0;
+  }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  bool full() const { return count == CAPACITY; }
+
+  Packet &operator[](size_t index) {
+    assert(index < count);
+    return *packets[index];
+  }
+  const Packet &operator[](size_t index) const {
+    assert(index < count);
+    return *packets[index];
+  }
+
+  Time getArrivalTime() const { return arrivalTime; }
+
+private:
+  Time arrivalTime;
+  size_t count;
+  std::array<std::optional<Packet>, CAPACITY> packets;
+};
+
+} // namespace E
+
+#endif /* E_PACKETBATCH_HPP_ */
@@ -0,0 +1,139 @@
+/**
+ * @file   E_PacketPool.hpp
+ * @brief  Header for E::PacketPool and E::PacketBuffer
+ */
+
+#ifndef E_PACKETPOOL_HPP_
+#define E_PACKETPOOL_HPP_
+
+#include <E/E_Common.hpp>
+
+namespace E {
+class PacketPool;
+
+/**
+ * @brief PacketBuffer is a reference-counted handle to Packet storage.
+ * Copying a handle shares the storage.
+ *
+ * @note The reference count is not atomic. Packets of a System are only
+ * touched by the thread running that System.
+ */
+class PacketBuffer {
+public:
+  PacketBuffer() : chunk(nullptr) {}
+  PacketBuffer(const PacketBuffer &other);
+  PacketBuffer(PacketBuffer &&other) noexcept;
+  PacketBuffer &operator=(const PacketBuffer &other);
+  PacketBuffer &operator=(PacketBuffer &&other) noexcept;
+  ~PacketBuffer();
+
+  /**
+   * @brief Allocate storage from the PacketPool of the current thread
+   * (or from the heap if there is none).
+   * @param size Required size. The storage may be larger.
+   * @param zero Zero the first size bytes.
+   * @return New storage.
+   */
+  static PacketBuffer allocate(size_t size, bool zero);
+
+  char *data() { return chunk->data(); }
+  const char *data() const { return chunk->data(); }
+
+  /**
+   * @return Usable size of the storage.
+   */
+  size_t size() const { return chunk ? chunk->capacity : 0; }
+
+  /**
+   * @return Whether other handles share this storage.
+   */
+  bool shared() const { return chunk && chunk->refcount > 1; }
+
+  explicit operator bool() const { return chunk != nullptr; }
+
+private:
+  class Chunk {
+  public:
+    size_t refcount;
+    size_t capacity;
+    std::shared_ptr<PacketPool> pool;
+    char *data() { return reinterpret_cast<char *>(this + 1); }
+  };
+
+  explicit PacketBuffer(Chunk *chunk) : chunk(chunk) {}
+  static Chunk *newChunk(size_t capacity);
+  void release();
+
+  Chunk *chunk;
+
+  friend class PacketPool;
+};
+
+/**
+ * @brief PacketPool recycles Packet storage in two size classes
+ * (small packets and MTU-sized frames).
+ * Storage larger than the MTU class is allocated from the heap directly.
+ *
+ * Each NetworkSystem owns a PacketPool and installs it for the thread that
+ * created it, so Packets allocated by its modules are served from the pool.
+ *
+ * @see NetworkSystem::getPacketPoolStatistics
+ */
+class PacketPool : public std::enable_shared_from_this<PacketPool> {
+public:
+  static constexpr size_t SMALL_SIZE = 256;
+  static constexpr size_t MTU_SIZE = 2048;
+
+  enum SizeClass {
+    SMALL,
+    MTU,
+    SIZE_CLASS_COUNT,
+  };
+
+  class Statistics {
+  public:
+    /**
+     * @brief Allocations served from recycled storage.
+     */
+    Size hits = 0;
+    /**
+     * @brief Allocations that fit a size class but found no free storage.
+     */
+    Size misses = 0;
+    /**
+     * @brief Allocations larger than every size class.
+     */
+    Size oversized = 0;
+    /**
+     * @brief Storage currently kept for reuse.
+     */
+    Size cached = 0;
+  };
+
+  PacketPool();
+  ~PacketPool();
+
+  Statistics getStatistics() const;
+
+  /**
+   * @brief Install a pool for the calling thread.
+   * @param pool Pool to install (may be null).
+   * @return Previously installed pool.
+   */
+  static PacketPool *install(PacketPool *pool);
+
+private:
+  std::array<std::vector<PacketBuffer::Chunk *>, SIZE_CLASS_COUNT> freeList;
+  Statistics stats;
+
+  static thread_local PacketPool *current;
+
+  PacketBuffer::Chunk *allocate(size_t size);
+  void recycle(PacketBuffer::Chunk *chunk);
+
+  friend class PacketBuffer;
+};
+
+} // namespace E
+
+#endif /* E_PACKETPOOL_HPP_ */
@@ -0,0 +1,177 @@
+/**
+ * @file   E_PacketTracker.hpp
+ * @brief  Header for E::PacketTracker
+ */
+
+#ifndef E_PACKETTRACKER_HPP_
+#define E_PACKETTRACKER_HPP_
+
+#include <E/E_Common.hpp>
+#include <E/E_Module.hpp>
+#include <E/Networking/E_NetworkLog.hpp>
+
+/**
+ * PACKET_TRACE(statement) runs statement only if the library is built with
+ * packet lifecycle tracking (CMake option PACKET_TRACE, which defines
+ * ENABLE_PACKET_TRACE). Otherwise the statement is compiled out.
+ */
+#ifdef ENABLE_PACKET_TRACE
+#define PACKET_TRACE(statement) statement
+#else
+#define PACKET_TRACE(statement)
+#endif
+
+#ifdef ENABLE_PACKET_TRACE
+namespace E {
+class Packet;
+class NetworkSystem;
+
+/**
+ * @brief PacketTracker follows every Packet of a System from allocation to
+ * free: allocation site, clone tree, and a timestamp at every hop.
+ *
+ * A tracked packet is identified by its UUID. Copies share the record, which
+ * is freed when the last copy is destroyed. Allocation, clone and free are
+ * logged with NetworkLog::PACKET_ALLOC, PACKET_CLONE and PACKET_FREE.
+ * A record is dropped once its packet and every clone of it are freed, so
+ * memory is bounded by the packets in flight.
+ *
+ * Each NetworkSystem owns a PacketTracker. After its modules are destroyed,
+ * it reports packets still alive, which are leaked. Without tracking, the
+ * class does not exist at all.
+ *
+ * @see NetworkSystem::getPacketTracker
+ */
+class PacketTracker : private NetworkLog {
+public:
+  /**
+   * @brief Points in the life of a packet.
+   */
+  enum Stage {
+    ALLOCATED,
+    CLONED,
+    INGRESS,          // arrived at a Host or Link from a Wire
+    EGRESS,           // sent by a Host to a Wire
+    LINK_ENQUEUE,     // pushed to a Link output queue
+    LINK_DEQUEUE,     // popped from a Link output queue
+    WIRE_TRANSMIT,    // received by a Wire
+    WIRE_TRANSMITTED, // serialized onto a Wire (propagation follows)
+    FREED,
+  };
+
+  class Hop {
+  public:
+    Stage stage;
+    Time time;
+    ModuleID module; // 0 if the hop is not in a module
+  };
+
+  class Record {
+  public:
+    std::optional<UUID> parent;
+    Time cloneTime = 0;
+    const void *site = nullptr;
+    size_t references = 0;
+    size_t clones = 0; // clones whose records are kept
+    std::vector<Hop> hops;
+  };
+
+  /**
+   * @brief Time a packet (including its clone ancestors) spent in each part
+   * of the network.
+   */
+  class Latency {
+  public:
+    /**
+     * @brief Time in Host modules and switching logic.
+     */
+    Time processing = 0;
+    /**
+     * @brief Time waiting in Link output queues.
+     */
+    Time queueing = 0;
+    /**
+     * @brief Transmission time on Links and Wires (including the wait for a
+     * busy Wire).
+     */
+    Time serialization = 0;
+    /**
+     * @brief Propagation delay of Wires.
+     */
+    Time propagation = 0;
+  };
+
+  PacketTracker(NetworkSystem &system);
+  ~PacketTracker();
+
+  /**
+   * @brief Install a tracker for the calling thread.
+   * @param tracker Tracker to install (may be null).
+   * @return Previously installed tracker.
+   */
+  static PacketTracker *install(PacketTracker *tracker);
+
+  static void allocated(UUID uuid, const void *site);
+  static void cloned(UUID parent, UUID child, const void *site);
+  static void referenced(UUID uuid);
+  static void released(UUID uuid);
+
+  /**
+   * @brief Record a hop of a packet.
+   * @param packet Packet passing the point.
+   * @param stage Point being passed.
+   * @param module Module the packet is in.
+   * @param time Time of the hop (current time if not given).
+   */
+  static void stamp(const Packet &packet, Stage stage, Module *module,
+                    std::optional<Time> time = {});
+
+  /**
+   * @param uuid Packet UUID.
+   * @return Lifecycle record of the packet, or null if it is not tracked
+   * (or it and its clones are freed).
+   */
+  const Record *getRecord(UUID uuid) const;
+
+  /**
+   * @param uuid Packet UUID.
+   * @return Latency decomposition up to the last hop of the packet.
+   */
+  Latency getLatency(UUID uuid) const;
+
+  /**
+   * @return UUIDs of packets which are not freed yet.
+   */
+  std::vector<UUID> getAlivePackets() const;
+
+  /**
+   * @brief Log every packet which is not freed yet.
+   * @return Number of such packets.
+   */
+  size_t reportLeaks();
+
+private:
+  NetworkSystem &system;
+  std::unordered_map<UUID, Record> records;
+  // Names are kept, since leaks are reported after the modules are gone.
+  std::unordered_map<ModuleID, std::string> moduleNames;
+  size_t alive;
+
+  static thread_local PacketTracker *current;
+
+  /**
+   * @brief Append the hops of an ancestor up to a clone point.
+   */
+  void collectHops(UUID uuid, Time until, std::vector<Hop> &hops) const;
+  /**
+   * @brief Drop the record of a freed packet without kept clones, and then
+   * its ancestors which are left in the same state.
+   */
+  void erase(UUID uuid);
+  std::string describeSite(const void *site) const;
+};
+
+} // namespace E
+#endif /* ENABLE_PACKET_TRACE */
+
+#endif /* E_PACKETTRACKER_HPP_ */
@@ -0,0 +1,125 @@
+/**
+ * @file   E_Sampler.hpp
+ * @brief  Header for E::Sampler
+ */
+
+#ifndef E_SAMPLER_HPP_
+#define E_SAMPLER_HPP_
+
+#include <E/E_Common.hpp>
+#include <E/E_Module.hpp>
+#include <E/Networking/E_NetworkLog.hpp>
+
+namespace E {
+class NetworkSystem;
+
+/**
+ * @brief Sampler periodically evaluates registered probes in virtual time
+ * and records their values (e.g. queue occupancy, cwnd, link utilization).
+ *
+ * Every probe has its own interval, but all probes due at the same virtual
+ * time are evaluated by a single tick event. Samples are kept in a columnar
+ * buffer: one time column shared by every probe and one value column per
+ * probe. A probe which is not due at a tick has NaN in its column.
+ *
+ * Sampling stops by itself when no other event is pending in the System,
+ * so NetworkSystem::run(0) still terminates.
+ *
+ * @see NetworkSystem::addProbe
+ */
+class Sampler : public Module, private NetworkLog {
+public:
+  using Probe = std::function<Real(void)>;
+  using ProbeID = size_t;
+
+  /**
+   * @brief Output formats supported by Sampler::flush.
+   *
+   * CSV has a header line (time followed by probe names) and one line per
+   * tick. Missing samples are empty cells.
+   *
+   * BINARY is a little-endian columnar dump:
+   * magic "ESMP" (uint32), version (uint32), probe count (uint64),
+   * tick count (uint64), probe names (uint32 length + bytes each),
+   * time column (uint64 x ticks), and one value column (double x ticks) per
+   * probe.
+   */
+  enum class Format {
+    CSV,
+    BINARY,
+  };
+
+  Sampler(NetworkSystem &system);
+  virtual ~Sampler();
+
+  /**
+   * @brief Register a probe.
+   * @param name Column name of this probe.
+   * @param interval Sampling interval in virtual time. Must not be zero.
+   * @param probe Callback returning the current value.
+   * The first sample is taken at [current time] + [interval].
+   * @return Index of the value column of this probe.
+   */
+  virtual ProbeID addProbe(std::string name, Time interval, Probe probe) final;
+
+  /**
+   * @brief Set the file written by Sampler::flush.
+   * NetworkSystem flushes the Sampler automatically when it is destroyed.
+   * @param filename Output file name.
+   * @param format Output format.
+   */
+  virtual void setOutput(const std::string &filename,
+                         Format format = Format::CSV) final;
+
+  /**
+   * @brief Write all samples to the file given by Sampler::setOutput.
+   * Does nothing if no output is set.
+   */
+  virtual void flush() final;
+
+  virtual void writeCSV(const std::string &filename) final;
+  virtual void writeBinary(const std::string &filename) final;
+
+  /**
+   * @return Virtual time of every tick.
+   */
+  const std::vector<Time> &getTickTimes() const;
+
+  /**
+   * @param probeID Probe returned by Sampler::addProbe.
+   * @return Value column of the probe (aligned with Sampler::getTickTimes).
+   */
+  const std::vector<Real> &getSamples(ProbeID probeID) const;
+
+private:
+  class Column {
+  public:
+    std::string name;
+    Time interval;
+    Time nextSample;
+    Probe probe;
+    std::vector<Real> values;
+  };
+
+  class Tick : public Module::MessageBase {};
+
+  NetworkSystem &networkSystem;
+  std::vector<Time> ticks;
+  std::vector<Column> columns;
+  std::optional<UUID> scheduled;
+  Time scheduledTime;
+  std::optional<std::pair<std::string, Format>> output;
+
+  void schedule();
+
+  virtual Module::Message messageReceived(const ModuleID from,
+                                          Module::MessageBase &message) final;
+  virtual void messageFinished(const ModuleID to, Module::Message message,
+                               Module::MessageBase &response) final;
+  virtual void messageCancelled(const ModuleID to,
+                                Module::Message message) final;
+};
+
+} // namespace E
+
+#endif /* E_SAMPLER_HPP_ */
@@ -14,7 +14,8 @@ namespace E {
 
 class Switch : public Link {
 private:
-  std::unordered_map<ModuleID, std::unordered_set<uint64_t>> mac_table;
+  // MAC address -> sorted port indices
+  std::unordered_map<uint64_t, std::vector<int>> mac_table;
   E::UniformDistribution dist;
   bool unreliable;
   Real drop_base;
@@ -22,8 +23,18 @@ private:
   Real drop_base_limit;
   Real drop_base_final;
 
+  /**
+   * @return Ports learned for the destination MAC of the packet, or null
+   * if it is broadcast or unknown.
+   */
+  const std::vector<int> *lookup(const Packet &packet) const;
+  void forward(const ModuleID inWireID, Packet &&packet,
+               const std::vector<int> *outPorts);
+  void transmit(const ModuleID wireID, Packet &&packet);
+
 protected:
   virtual void packetArrived(const ModuleID inWireID, Packet &&packet);
+  virtual void packetsArrived(const ModuleID inWireID, PacketBatch &&batch);
 
 public:
   Switch(std::string name, NetworkSystem &system, bool unreliable = false);
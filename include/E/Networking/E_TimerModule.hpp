@@ -8,6 +8,7 @@
 #ifndef E_HOST_TIMERMODULE_HPP_
 #define E_HOST_TIMERMODULE_HPP_
 #include <E/E_Common.hpp>
+#include <E/E_Module.hpp>
 
 namespace E {
 
@@ -69,9 +70,80 @@ protected:
    */
   virtual void cancelTimer(UUID key) final;
 
+  /**
+   * @brief A timer message which delivers itself to its module.
+   * @see TypedTimerModule
+   */
+  class TimerEvent : public Module::MessageBase {
+  public:
+    virtual bool isTimerEvent() const override { return true; }
+    virtual void fire() = 0;
+  };
+
+  /**
+   * @brief Request an alarm which fires the given event.
+   *
+   * @param event Event to fire.
+   * @param timeAfter Specify when the alarm will ring.
+   * @return Unique ID that indicates the timer request.
+   */
+  virtual UUID addTimerEvent(std::unique_ptr<TimerEvent> event,
+                             Time timeAfter) final;
+
   friend class Host;
 };
 
+/**
+ * @brief TypedTimerModule is a TimerModule whose timers carry a payload of
+ * a fixed type.
+ * The payload is stored in the timer message itself, so adding a timer
+ * allocates nothing but the message, and timerCallback receives the payload
+ * without any cast.
+ *
+ * @param Payload Type of the timer payloads (e.g. a connection ID and a
+ * timer kind).
+ */
+template <typename Payload> class TypedTimerModule : public TimerModule {
+protected:
+  TypedTimerModule(std::string name, Host &host) : TimerModule(name, host) {}
+  virtual ~TypedTimerModule() {}
+
+  /**
+   * @brief This function is automatically when requested alarm is triggered.
+   *
+   * @param payload Payload that you specified via addTimer
+   */
+  virtual void timerCallback(Payload &payload) = 0;
+
+  /**
+   * @brief Request an alarm that rings after specified time.
+   *
+   * @param payload Payload given to timerCallback.
+   * @param timeAfter Specify when the alarm will ring.
+   * @return Unique ID that indicates the timer request (see cancelTimer).
+   */
+  UUID addTimer(Payload payload, Time timeAfter) {
+    return addTimerEvent(std::make_unique<Event>(*this, std::move(payload)),
+                         timeAfter);
+  }
+
+private:
+  class Event : public TimerEvent {
+  public:
+    TypedTimerModule &module;
+    Payload payload;
+    Event(TypedTimerModule &module, Payload &&payload)
+        : module(module), payload(std::move(payload)) {}
+    virtual void fire() override { module.timerCallback(payload); }
+  };
+
+  // Every timer of this module is an Event.
+  virtual void timerCallback(std::any payload) final {
+    (void)payload;
+    assert(0);
+  }
+};
+
 } // namespace E
 
 #endif /* E_HOST_TIMERMODULE_HPP_ */
@@ -12,6 +12,7 @@
 #include <E/E_Module.hpp>
 #include <E/Networking/E_NetworkLog.hpp>
 #include <E/Networking/E_Packet.hpp>
+#include <E/Networking/E_PacketBatch.hpp>
 
 namespace E {
 class NetworkSystem;
@@ -80,14 +81,33 @@ public:
     Packet packet;
 
     Message(enum MessageType type, Packet &&packet)
-        : type(type), packet(packet) {}
+        : type(type), packet(std::move(packet)) {}
 
     ~Message() override = default;
   };
 
+  /**
+   * @brief Carries several packets as one message.
+   * Packets sent to a Wire in one batch are delivered in batches of packets
+   * with the same arrival time; a batch of one is delivered as a Message.
+   */
+  class BatchMessage : public Module::MessageBase {
+  public:
+    enum MessageType type;
+    PacketBatch batch;
+
+    BatchMessage(enum MessageType type, PacketBatch &&batch)
+        : type(type), batch(std::move(batch)) {}
+
+    ~BatchMessage() override = default;
+  };
+
   virtual Time nextSendAvailable(const ModuleID me) final;
 
 private:
+  Time transmit(int destination, const Packet &packet, const ModuleID from);
+  void deliver(int destination, PacketBatch &&batch, Time delay);
+
   virtual Module::Message messageReceived(const ModuleID from,
                                           Module::MessageBase &message) final;
   virtual void messageFinished(const ModuleID to, Module::Message message,
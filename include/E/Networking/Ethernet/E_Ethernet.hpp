@@ -14,12 +14,17 @@
 namespace E {
 
 class Ethernet : public HostModule, private RoutingInfoInterface {
+private:
+  ModuleHandle ipv4Handle;
+  ModuleHandle ipv6Handle;
+
 public:
   Ethernet(Host &host);
   virtual ~Ethernet();
 
 protected:
   virtual void packetArrived(std::string fromModule, Packet &&packet) final;
+  virtual void packetArrived(ModuleHandle fromModule, Packet &&packet) final;
 };
 
 } // namespace E
@@ -16,6 +16,10 @@ namespace E {
 class IPv4 : public HostModule {
 private:
   uint16_t identification;
+  ModuleHandle ethernetHandle;
+  ModuleHandle tcpHandle;
+  ModuleHandle udpHandle;
+  ModuleHandle ospfHandle;
 
 public:
   IPv4(Host &host);
@@ -23,6 +27,7 @@ public:
 
 protected:
   virtual void packetArrived(std::string fromModule, Packet &&packet) final;
+  virtual void packetArrived(ModuleHandle fromModule, Packet &&packet) final;
 };
 
 } // namespace E
@@ -40,6 +40,44 @@ protected:
   virtual int msleep(uint64_t millisleep) final;
   virtual int sleep(uint64_t sleep) final;
   virtual int gettimeofday(struct timeval *tv, struct timezone *tz) final;
+  virtual int fcntl(int fd, int command, int argument = 0) final;
+  virtual int poll(struct pollfd *fds, nfds_t nfds, int timeout) final;
+  virtual int epoll_create(int size__unused) final;
+  virtual int epoll_ctl(int epfd, int operation, int fd,
+                        SystemCallInterface::EpollEvent *event) final;
+  virtual int epoll_wait(int epfd, SystemCallInterface::EpollEvent *events,
+                         int maxevents, int timeout) final;
+  virtual int readv(int fd, const struct iovec *iov, int iovcnt) final;
+  virtual int writev(int fd, const struct iovec *iov, int iovcnt) final;
+
+  /**
+   * @brief Copy data into a new immutable buffer descriptor, which
+   * sendfile can send any number of times without copying it again.
+   * It is only a source for sendfile: read and write on it fail with
+   * EBADF. Close it with close().
+   */
+  virtual int buffer_create(const void *data, size_t length) final;
+
+  /**
+   * @brief Send count bytes of buffer descriptor in_fd from *offset
+   * (0 if offset is null) to out_fd. *offset is advanced by the bytes sent.
+   */
+  virtual int sendfile(int out_fd, int in_fd, off_t *offset,
+                       size_t count) final;
+
+  /**
+   * @brief Queue a read, write, connect or accept for
+   * SystemCallApplication::E_SyscallSubmit. The completion carries the
+   * return value the blocking call would have had.
+   */
+  virtual void prepareRead(int fd, void *buf, size_t count,
+                           uint64_t userData) final;
+  virtual void prepareWrite(int fd, const void *buf, size_t count,
+                            uint64_t userData) final;
+  virtual void prepareConnect(int sockfd, const struct sockaddr *addr,
+                              socklen_t addrlen, uint64_t userData) final;
+  virtual void prepareAccept(int sockfd, struct sockaddr *addr,
+                             socklen_t *addrlen, uint64_t userData) final;
 };
 
 } // namespace E
@@ -31,6 +31,16 @@ UUID Module::sendMessageSelf(Module::Message message, Time timeAfter) {
   return sendMessage(id, std::move(message), timeAfter);
 }
 
+UUID Module::reserveMessageID() { return system.reserveMessageID(); }
+
+bool Module::hasMessageBefore(UUID messageID) {
+  return system.hasMessageBefore(messageID);
+}
+
+UUID Module::sendReservedMessageSelf(Module::Message message, UUID messageID) {
+  return system.sendReservedMessage(id, id, std::move(message), messageID);
+}
+
 std::string Module::getModuleName() {
 
   const char *type_name = typeid(*this).name();
@@ -16,8 +16,11 @@ System::System() {
   this->currentID = 0;
 }
 
-System::~System() {
+System::~System() { destroyModules(); }
+
+void System::destroyModules() {
   activeTimer.clear();
+  cancelledCount = 0;
   while (!timerQueue.empty()) {
     timerQueue.pop();
   }
@@ -29,6 +32,7 @@ System::~System() {
       abort();
     }
   }
+  registeredModule.clear();
 }
 UUID System::sendMessage(const ModuleID from, const ModuleID to,
                          Module::Message message, Time timeAfter) {
@@ -42,6 +46,33 @@ UUID System::sendMessage(const ModuleID from, const ModuleID to,
 
   return uuid;
 }
+UUID System::sendReservedMessage(const ModuleID from, const ModuleID to,
+                                 Module::Message message, UUID messageID) {
+  assert(messageID <= currentUUID);
+  bool ret = activeUUID.insert(messageID).second;
+  (void)ret;
+  assert(ret);
+  TimerContainer container = std::make_shared<TimerContainerInner>(
+      from, to, false, this->getCurrentTime(), std::move(message), messageID);
+
+  activeTimer.insert(std::pair<UUID, TimerContainer>(messageID, container));
+  timerQueue.push(container);
+
+  return messageID;
+}
+
+UUID System::reserveMessageID() { return ++currentUUID; }
+
+bool System::hasMessageBefore(UUID messageID) {
+  // Runnables run before the next message is delivered.
+  if (!runnableReady.empty())
+    return true;
+  if (timerQueue.empty())
+    return false;
+  const TimerContainer &next = timerQueue.top();
+  return next->wakeup == currentTime && next->uuid < messageID;
+}
+
 UUID System::allocateUUID() {
 
   UUID candidate = ++currentUUID;
@@ -66,12 +97,19 @@ bool System::isRegistered(const ModuleID module) {
 
 Time System::getCurrentTime() { return this->currentTime; }
 
+Size System::getPendingMessageCount() {
+  return this->activeTimer.size() - this->cancelledCount;
+}
+
 bool System::cancelMessage(UUID messageID) {
   std::unordered_map<UUID, TimerContainer>::iterator iter =
       this->activeTimer.find(messageID);
   if (iter == this->activeTimer.end())
     return false;
-  iter->second->canceled = true;
+  if (!iter->second->canceled) {
+    iter->second->canceled = true;
+    this->cancelledCount++;
+  }
   return true;
 }
 
@@ -157,6 +195,9 @@ void System::run(Time till) {
             container->to, std::move(container->message));
       }
 
+      // It may have been cancelled during its own delivery.
+      if (container->canceled)
+        this->cancelledCount--;
       this->activeTimer.erase(container->uuid);
       this->activeUUID.erase(container->uuid);
       assert(container.use_count() == 1);
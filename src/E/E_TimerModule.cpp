@@ -17,7 +17,12 @@ TimerModule::~TimerModule() {}
 std::string TimerModule::getTimerModuleName() { return name; }
 
 UUID TimerModule::addTimer(std::any payload, Time timeAfter) {
-  return host.addTimer(name, payload, timeAfter);
+  return host.addTimer(this, std::move(payload), timeAfter);
+}
+
+UUID TimerModule::addTimerEvent(std::unique_ptr<TimerEvent> event,
+                                Time timeAfter) {
+  return host.addTimer(std::move(event), timeAfter);
 }
 
 void TimerModule::cancelTimer(UUID key) { host.cancelTimer(key); }
@@ -8,6 +8,7 @@
 #include <E/E_Module.hpp>
 #include <E/E_System.hpp>
 #include <E/E_TimeUtil.hpp>
+#include <E/Networking/E_HeaderView.hpp>
 #include <E/Networking/E_Host.hpp>
 #include <E/Networking/E_Link.hpp>
 #include <E/Networking/E_Networking.hpp>
@@ -17,30 +18,63 @@
 namespace E {
 Host::Host(std::string name, NetworkSystem &system)
     : NetworkModule(system), NetworkLog(static_cast<System &>(system)),
-      networkSystem(system) {
+      networkSystem(system), pidBitmap(MAX_PID) {
 
   ports.clear();
   this->pidStart = 0;
-  this->syscallIDStart = 0;
+  ModuleHandle host = getModuleHandle("Host");
+  (void)host;
+  assert(host == HOST_HANDLE);
+  ModuleHandle loopback = getModuleHandle("Loopback");
+  (void)loopback;
+  assert(loopback == LOOPBACK_HANDLE);
+  ethernetHandle = getModuleHandle("Ethernet");
   addHostModule<DefaultSystemCall>(std::ref(*this));
 
   this->running = true;
+  this->checksumOffload = false;
+  this->cpuModelSince = 0;
+  this->hopQueueScheduled = false;
+  this->loopbackPort = std::nullopt;
 }
 
-Host::~Host() { ports.clear(); }
+Host::~Host() {
+  ports.clear();
+  // Modules may use the Host while they are destroyed.
+  processInfoMap.clear();
+  timerModuleMap.clear();
+  hostModuleMap.clear();
+  interfaceMap.clear();
+}
 
 bool Host::isRunning(void) { return this->running; }
 
+ModuleHandle Host::getModuleHandle(const std::string &name) {
+  auto [iter, inserted] =
+      handleMap.insert({name, ModuleHandle(handleNames.size())});
+  if (inserted) {
+    handleNames.push_back(name);
+    handleModules.push_back(nullptr);
+    namedDelivery.push_back(false);
+  }
+  return iter->second;
+}
+
+const std::string &Host::getModuleHandleName(ModuleHandle handle) const {
+  assert(handle.getIndex() < handleNames.size());
+  return handleNames[handle.getIndex()];
+}
+
 int Host::cleanUp(void) {
   this->running = false;
   int missing = 0;
   std::list<UUID> syscall_to_wakeup;
-  for (auto iter : this->syscallMap) {
-    syscall_to_wakeup.push_back(iter.first);
+  this->syscallMap.forEach([&](UUID syscallUUID, const PendingSyscall &) {
+    syscall_to_wakeup.push_back(syscallUUID);
     print_log(SYSCALL_ERROR, "Unfinished system call at %s",
               this->getModuleName().c_str());
     missing++;
-  }
+  });
   for (auto iter : syscall_to_wakeup) {
     this->returnSystemCall(iter, -1);
   }
@@ -49,6 +83,12 @@ int Host::cleanUp(void) {
 
 Module::Message Host::messageReceived(const ModuleID from,
                                       Module::MessageBase &message) {
+  // Timers of TypedTimerModules deliver themselves.
+  if (message.isTimerEvent()) {
+    static_cast<TimerModule::TimerEvent &>(message).fire();
+    return nullptr;
+  }
+
   if (typeid(message) == typeid(Wire::Message &)) {
     Wire::Message &portMessage = dynamic_cast<Wire::Message &>(message);
     assert(portMessage.type == Wire::MessageType::PACKET_FROM_PORT);
@@ -58,102 +98,60 @@ Module::Message Host::messageReceived(const ModuleID from,
                 this->getModuleName().c_str(), portMessage.packet.getSize(),
                 this->getModuleName(from).c_str());
       // this->freePacket(hostMessage->packet);
+      stampIngress(from, portMessage.packet);
+      receivePacket(std::move(portMessage.packet));
+    }
+    return nullptr;
+  }
 
-      this->sendPacketToModule({}, "Ethernet", std::move(portMessage.packet));
+  if (typeid(message) == typeid(Wire::BatchMessage &)) {
+    Wire::BatchMessage &batchMessage =
+        dynamic_cast<Wire::BatchMessage &>(message);
+    assert(batchMessage.type == Wire::MessageType::PACKET_FROM_PORT);
+    PacketBatch &batch = batchMessage.batch;
+    for (size_t k = 0; k < batch.size() && this->running; k++) {
+      print_log(PACKET_FROM_HOST,
+                "Host [%s] get a packet [size:%zu] from module [%s]",
+                this->getModuleName().c_str(), batch[k].getSize(),
+                this->getModuleName(from).c_str());
+      stampIngress(from, batch[k]);
+      receivePacket(std::move(batch[k]));
     }
     return nullptr;
   }
 
   if (typeid(message) == typeid(PacketPass &)) {
-    PacketPass &packetPass = dynamic_cast<PacketPass &>(message);
-    if (this->running == true) {
-      std::string fromName = packetPass.from.value_or("Host");
-      hostModuleMap[packetPass.to.value()]->packetArrived(
-          fromName, std::move(packetPass.packet));
-    }
+    deliverPacketHops();
+  } else if (typeid(message) == typeid(Ingress &)) {
+    Ingress &ingress = dynamic_cast<Ingress &>(message);
+    if (this->running)
+      this->sendPacketToModule(HOST_HANDLE, ethernetHandle,
+                               std::move(ingress.packet));
+  } else if (typeid(message) == typeid(Loopback &)) {
+    Loopback &loopback = dynamic_cast<Loopback &>(message);
+    if (this->running)
+      this->sendPacketToModule(LOOPBACK_HANDLE, loopback.to,
+                               std::move(loopback.packet));
   } else if (typeid(message) == typeid(Syscall &)) {
     Syscall &syscall = dynamic_cast<Syscall &>(message);
-
-    assert(syscall.pid != -1);
-    auto appIter = this->processInfoMap.find(syscall.pid);
-    assert(appIter != this->processInfoMap.end());
-    assert(syscall.pid == appIter->second.application->pid);
-
-    Domain domain = 0;
-    Protocol protocol = 0;
-    switch (syscall.param.syscallNumber) {
-    case SystemCallInterface::SystemCall::SOCKET: {
-      domain = (Domain)std::get<int>(syscall.param.params[0]);
-      protocol = (Domain)std::get<int>(syscall.param.params[2]);
-      break;
-    }
-    case SystemCallInterface::SystemCall::NSLEEP:
-    case SystemCallInterface::SystemCall::GETTIMEOFDAY: {
-      break;
-    }
-
-    case SystemCallInterface::SystemCall::CLOSE:
-    case SystemCallInterface::SystemCall::READ:
-    case SystemCallInterface::SystemCall::WRITE:
-    case SystemCallInterface::SystemCall::CONNECT:
-    case SystemCallInterface::SystemCall::LISTEN:
-    case SystemCallInterface::SystemCall::ACCEPT:
-    case SystemCallInterface::SystemCall::BIND:
-    case SystemCallInterface::SystemCall::GETSOCKNAME:
-    case SystemCallInterface::SystemCall::GETPEERNAME: {
-
-      int fd = std::get<int>(syscall.param.params[0]);
-      auto nsIter = appIter->second.fdToDomain.find(fd);
-      assert(nsIter != appIter->second.fdToDomain.end());
-
-      domain = nsIter->second.first;
-      protocol = nsIter->second.second;
-      break;
-    }
-    default:
-      assert(0);
-    }
-
-    Namespace ns = Namespace(domain, protocol);
-    auto iter = interfaceMap.find(ns);
-
-    if (iter != interfaceMap.end()) {
-      auto iface = iter->second;
-      UUID curSyscallID = this->syscallIDStart;
-      do {
-        if (syscallMap.find(curSyscallID) == syscallMap.end()) {
-          syscallIDStart = curSyscallID + 1;
-          syscallMap.insert({curSyscallID, syscall.pid});
-          break;
-        }
-        curSyscallID++;
-      } while (curSyscallID != this->syscallIDStart);
-      assert(curSyscallID != this->syscallIDStart);
-
-      print_log(SYSCALL_RAISED,
-                "System call[syscall_no:%d, unique_id: %" PRIu64
-                "] has raised from "
-                "app[pid:%d] at [%s]",
-                syscall.param.syscallNumber, curSyscallID, syscall.pid,
-                this->getModuleName().c_str());
-      iface->systemCallback(curSyscallID, syscall.pid, syscall.param);
-    }
+    dispatchSystemCall(syscall.pid, syscall.param, {});
+  } else if (typeid(message) == typeid(SubmittedSyscall &)) {
+    SubmittedSyscall &syscall = dynamic_cast<SubmittedSyscall &>(message);
+    processInfoMap.at(syscall.pid).submitted.erase(syscall.messageID);
+    dispatchSystemCall(syscall.pid, syscall.submission.param,
+                       syscall.submission.userData);
   } else if (typeid(message) == typeid(Timer &)) {
     Timer &timer = dynamic_cast<Timer &>(message);
-    timerModuleMap[timer.from]->timerCallback(timer.payload);
+    timer.module->timerCallback(std::move(timer.payload));
   } else if (typeid(message) == typeid(Return &)) {
     Return &ret = dynamic_cast<Return &>(message);
     auto iter = processInfoMap.find(ret.pid);
     assert(iter != processInfoMap.end());
 
-    for (auto allSyscall : syscallMap) {
-      (void)allSyscall;
-      assert(
-          allSyscall.second !=
-          iter->second.application->pid); // no syscall pending for returned app
-    }
+    exitSystemCalls(ret.pid);
     networkSystem.delRunnable(iter->second.application);
     processInfoMap.erase(iter);
+    pidBitmap.reset(ret.pid);
 
     print_log(APPLICATION_RETRUN, "Application [ pid: %d] returend %d", ret.pid,
               ret.returnValue);
@@ -164,6 +162,162 @@ Module::Message Host::messageReceived(const ModuleID from,
 
   return nullptr;
 }
+
+void Host::dispatchSystemCall(
+    int pid, const SystemCallInterface::SystemCallParameter &param,
+    std::optional<uint64_t> userData) {
+  assert(pid != -1);
+  auto appIter = this->processInfoMap.find(pid);
+  assert(appIter != this->processInfoMap.end());
+  assert(pid == appIter->second.application->pid);
+
+  Domain domain = 0;
+  Protocol protocol = 0;
+  switch (param.syscallNumber) {
+  case SystemCallInterface::SystemCall::SOCKET: {
+    domain = (Domain)std::get<int>(param.params[0]);
+    protocol = (Domain)std::get<int>(param.params[2]);
+    break;
+  }
+  case SystemCallInterface::SystemCall::NSLEEP:
+  case SystemCallInterface::SystemCall::GETTIMEOFDAY:
+  case SystemCallInterface::SystemCall::FCNTL:
+  case SystemCallInterface::SystemCall::POLL:
+  case SystemCallInterface::SystemCall::EPOLL_CREATE:
+  case SystemCallInterface::SystemCall::EPOLL_CTL:
+  case SystemCallInterface::SystemCall::EPOLL_WAIT:
+  case SystemCallInterface::SystemCall::BUFFER_CREATE: {
+    break;
+  }
+
+  case SystemCallInterface::SystemCall::CLOSE:
+  case SystemCallInterface::SystemCall::READ:
+  case SystemCallInterface::SystemCall::WRITE:
+  case SystemCallInterface::SystemCall::CONNECT:
+  case SystemCallInterface::SystemCall::LISTEN:
+  case SystemCallInterface::SystemCall::ACCEPT:
+  case SystemCallInterface::SystemCall::BIND:
+  case SystemCallInterface::SystemCall::GETSOCKNAME:
+  case SystemCallInterface::SystemCall::GETPEERNAME:
+  case SystemCallInterface::SystemCall::READV:
+  case SystemCallInterface::SystemCall::WRITEV:
+  case SystemCallInterface::SystemCall::SENDFILE: {
+
+    int fd = std::get<int>(param.params[0]);
+    auto nsIter = appIter->second.fdToDomain.find(fd);
+    // Unknown descriptors fail with EBADF in DefaultSystemCall.
+    if (nsIter != appIter->second.fdToDomain.end()) {
+      domain = nsIter->second.first;
+      protocol = nsIter->second.second;
+    }
+    break;
+  }
+  default:
+    assert(0);
+  }
+
+  Namespace ns = Namespace(domain, protocol);
+  auto iter = interfaceMap.find(ns);
+
+  if (iter != interfaceMap.end()) {
+    auto iface = iter->second;
+    PendingSyscall pending{pid, userData, nullptr};
+    SystemCallInterface::SystemCallParameter delivered = param;
+    std::optional<int> result;
+    bool supported = currentInterfaces.count(iface.get())
+                         ? iface->supportsSystemCall(param.syscallNumber)
+                         : iface->SystemCallInterface::supportsSystemCall(
+                               param.syscallNumber);
+    if (!supported)
+      result = emulateSystemCall(pid, delivered, pending);
+    UUID curSyscallID = syscallMap.insert(std::move(pending));
+
+    print_log(SYSCALL_RAISED,
+              "System call[syscall_no:%d, unique_id: %" PRIu64
+              "] has raised from "
+              "app[pid:%d] at [%s]",
+              param.syscallNumber, curSyscallID, pid,
+              this->getModuleName().c_str());
+    if (result.has_value())
+      returnSystemCall(curSyscallID, result.value());
+    else
+      iface->systemCallback(curSyscallID, pid, delivered);
+  }
+}
+
+std::optional<int>
+Host::emulateSystemCall(int pid,
+                        SystemCallInterface::SystemCallParameter &param,
+                        PendingSyscall &pending) {
+  auto emulated = std::make_unique<EmulatedSyscall>();
+  int fd = std::get<int>(param.params[0]);
+
+  switch (param.syscallNumber) {
+  case SystemCallInterface::SystemCall::READV:
+  case SystemCallInterface::SystemCall::WRITEV: {
+    auto *iov = (const struct iovec *)std::get<void *>(param.params[1]);
+    int iovcnt = std::get<int>(param.params[2]);
+    if (iovcnt < 0 || iovcnt > MAX_IOV)
+      return -EINVAL;
+    if (iov == nullptr && iovcnt > 0)
+      return -EFAULT;
+
+    // Like READ and WRITE, transfer at most INT_MAX bytes.
+    size_t total = 0;
+    for (int k = 0; k < iovcnt; k++)
+      total += iov[k].iov_len;
+    total = std::min<size_t>(total, std::numeric_limits<int>::max());
+    emulated->bounce.resize(total);
+
+    if (param.syscallNumber == SystemCallInterface::SystemCall::READV) {
+      emulated->iov = iov;
+      emulated->iovcnt = iovcnt;
+    } else {
+      size_t done = 0;
+      for (int k = 0; k < iovcnt && done < total; k++) {
+        size_t length = std::min(iov[k].iov_len, total - done);
+        memcpy(&emulated->bounce[done], iov[k].iov_base, length);
+        done += length;
+      }
+    }
+    param.params[1] = (void *)emulated->bounce.data();
+    param.params[2] = (int)total;
+    param.syscallNumber =
+        param.syscallNumber == SystemCallInterface::SystemCall::READV
+            ? SystemCallInterface::SystemCall::READ
+            : SystemCallInterface::SystemCall::WRITE;
+    break;
+  }
+  case SystemCallInterface::SystemCall::SENDFILE: {
+    int in_fd = std::get<int>(param.params[1]);
+    auto *extra = (const SystemCallInterface::SystemCallParameter::
+                       ExtraParameters *)std::get<void *>(param.params[2]);
+    uint64_t offset = std::get<uint64_t>((*extra)[0]);
+    int count = std::get<int>((*extra)[1]);
+    auto source = getSharedBuffer(pid, in_fd);
+    if (!source.has_value())
+      return -EBADF;
+    if (count < 0)
+      return -EINVAL;
+    if (offset >= source->length || count == 0)
+      return 0;
+
+    size_t length = std::min<size_t>(count, source->length - offset);
+    param.params[1] = (void *)(source->buffer.data() + offset);
+    param.params[2] = (int)length;
+    param.syscallNumber = SystemCallInterface::SystemCall::WRITE;
+    emulated->source = std::move(source.value());
+    break;
+  }
+  default:
+    return {};
+  }
+
+  param.params[0] = fd;
+  pending.emulated = std::move(emulated);
+  return {};
+}
+
 void Host::messageFinished(const ModuleID to, Module::Message message,
                            Module::MessageBase &response) {
   (void)to;
@@ -186,31 +340,236 @@ void Host::sendPacket(size_t portIndex, Packet &&packet) {
   }
 
   auto portID = ports[portIndex];
+  PACKET_TRACE(PacketTracker::stamp(packet, PacketTracker::EGRESS, this));
+  Time delay = cpuModel.has_value()
+                   ? chargeCPU(selectCore(packet), packetCost(packet))
+                   : 0;
   auto portMessage =
       std::make_unique<Wire::Message>(Wire::PACKET_TO_PORT, std::move(packet));
-  sendMessage(portID, std::move(portMessage), 0);
+  sendMessage(portID, std::move(portMessage), delay);
+}
+
+void Host::receivePacket(Packet &&packet) {
+  if (cpuModel.has_value()) {
+    Time delay = chargeCPU(selectCore(packet), packetCost(packet));
+    if (delay > 0) {
+      sendMessageSelf(std::make_unique<Ingress>(std::move(packet)), delay);
+      return;
+    }
+  }
+  this->sendPacketToModule(HOST_HANDLE, ethernetHandle, std::move(packet));
+}
+
+void Host::loopBack(ModuleHandle fromModule, Packet &&packet) {
+  if (!loopbackPort.has_value()) {
+    print_log(MODULE_ERROR, "Loopback port is disabled. Drop packet.");
+    return;
+  }
+  if (packet.getSize() > EthernetHeaderView::SIZE + loopbackPort->mtu) {
+    print_log(MODULE_ERROR,
+              "Packet [size:%zu] exceeds the loopback MTU. Drop packet.",
+              packet.getSize());
+    return;
+  }
+
+  Time delay = loopbackPort->delay;
+  if (cpuModel.has_value())
+    delay += chargeCPU(selectCore(packet), packetCost(packet));
+  if (delay > 0)
+    sendMessageSelf(std::make_unique<Loopback>(fromModule, std::move(packet)),
+                    delay);
+  else
+    this->sendPacketToModule(LOOPBACK_HANDLE, fromModule, std::move(packet));
+}
+
+Time Host::chargeCPU(size_t core, Time cost) {
+  Time now = getCurrentTime();
+  coreBusyUntil[core] = std::max(now, coreBusyUntil[core]) + cost;
+  coreBusyTime[core] += cost;
+  return coreBusyUntil[core] - now;
+}
+
+Time Host::packetCost(const Packet &packet) const {
+  return cpuModel->perPacket +
+         (Time)std::llround(cpuModel->perByte * packet.getSize());
+}
+
+size_t Host::selectCore(const Packet &packet) const {
+  if (cpuModel->cores == 1)
+    return 0;
+
+  // Packets which are not IPv4 go to the first core.
+  ConstEthernetHeaderView ethernet(packet);
+  if (!ethernet ||
+      ethernet.getEtherType() != EthernetHeaderView::ETHERTYPE_IPV4)
+    return 0;
+  ConstIPv4HeaderView ip(packet);
+  if (!ip)
+    return 0;
+
+  uint8_t protocol = ip.getProtocol();
+  uint16_t sourcePort = 0, destinationPort = 0;
+  if (protocol == 0x06 || protocol == 0x11) {
+    ConstUDPHeaderView ports(packet, EthernetHeaderView::SIZE +
+                                         ip.getHeaderLength() * 4);
+    if (ports) {
+      sourcePort = ports.getSourcePort();
+      destinationPort = ports.getDestinationPort();
+    }
+  }
+  return NetworkUtil::symmetric_flow_hash(ip.getSource(), ip.getDestination(),
+                                          protocol, sourcePort,
+                                          destinationPort) %
+         cpuModel->cores;
+}
+
+size_t Host::selectCore(int pid) {
+  auto iter = processInfoMap.find(pid);
+  assert(iter != processInfoMap.end());
+  return iter->second.core.value_or(pid) % cpuModel->cores;
+}
+
+void Host::setCPUModel(std::optional<CPUModel> model) {
+  assert(!model.has_value() || model->cores > 0);
+  cpuModel = model;
+  size_t cores = model.has_value() ? model->cores : 0;
+  coreBusyUntil.assign(cores, getCurrentTime());
+  coreBusyTime.assign(cores, 0);
+  cpuModelSince = getCurrentTime();
+}
+
+std::optional<Host::CPUModel> Host::getCPUModel() const { return cpuModel; }
+
+void Host::setLoopbackPort(std::optional<LoopbackPort> port) {
+  loopbackPort = port;
+}
+
+std::optional<Host::LoopbackPort> Host::getLoopbackPort() const {
+  return loopbackPort;
+}
+
+bool Host::isLoopbackAddress(const ipv4_t &ip) {
+  if (!loopbackPort.has_value())
+    return false;
+  if (ip[0] == 127)
+    return true;
+  for (size_t k = 0; k < ports.size(); k++) {
+    if (getIPAddr((int)k) == ip)
+      return true;
+  }
+  return false;
+}
+
+void Host::setProcessAffinity(int pid, size_t core) {
+  auto iter = processInfoMap.find(pid);
+  assert(iter != processInfoMap.end());
+  iter->second.core = core;
+}
+
+Real Host::getCPUUtilization() {
+  if (!cpuModel.has_value())
+    return 0;
+  Real total = 0;
+  for (size_t core = 0; core < cpuModel->cores; core++)
+    total += getCoreUtilization(core);
+  return total / cpuModel->cores;
+}
+
+Real Host::getCoreUtilization(size_t core) {
+  Time now = getCurrentTime();
+  if (!cpuModel.has_value() || now == cpuModelSince)
+    return 0;
+  assert(core < cpuModel->cores);
+  // Work charged but not finished yet lies in [now, coreBusyUntil).
+  Time pending = coreBusyUntil[core] > now ? coreBusyUntil[core] - now : 0;
+  return (Real)(coreBusyTime[core] - pending) / (Real)(now - cpuModelSince);
 }
 
 Host::DefaultSystemCall::DefaultSystemCall(Host &host)
-    : SystemCallInterface(0, 0, host), TimerModule("DefaultSyscall", host) {}
+    : SystemCallInterface(0, 0, host),
+      TypedTimerModule<SyscallTimer>("DefaultSyscall", host) {
+  host.defaultSystemCall = this;
+}
 Host::DefaultSystemCall::~DefaultSystemCall() {}
 
-void Host::DefaultSystemCall::timerCallback(std::any payload) {
-  UUID syscallUUID = std::any_cast<UUID>(payload);
-  returnSystemCall(syscallUUID, 0);
+void Host::DefaultSystemCall::timerCallback(SyscallTimer &timer) {
+  if (timer.syscallNumber == SystemCallInterface::SystemCall::NSLEEP)
+    returnSystemCall(timer.syscallUUID, 0);
+  else
+    SystemCallInterface::host.pollTimedOut(timer);
 }
 
 void Host::DefaultSystemCall::systemCallback(UUID syscallUUID, int pid,
                                              const SystemCallParameter &param) {
-  (void)pid;
+  Host &host = static_cast<SystemCallInterface *>(this)->host;
   switch (param.syscallNumber) {
+  case SystemCallInterface::SystemCall::CLOSE: {
+    // Only epoll instances and buffers belong to this interface.
+    int fd = std::get<int>(param.params[0]);
+    if (host.processInfoMap.at(pid).buffers.erase(fd) > 0) {
+      host.removeFileDescriptor(pid, fd);
+      this->returnSystemCall(syscallUUID, 0);
+    } else {
+      this->returnSystemCall(syscallUUID, host.epollClose(pid, fd));
+    }
+    break;
+  }
+  case SystemCallInterface::SystemCall::BUFFER_CREATE: {
+    const void *data = std::get<void *>(param.params[0]);
+    size_t length = std::get<uint64_t>(param.params[1]);
+    this->returnSystemCall(syscallUUID, host.bufferCreate(pid, data, length));
+    break;
+  }
+  case SystemCallInterface::SystemCall::FCNTL: {
+    int fd = std::get<int>(param.params[0]);
+    int command = std::get<int>(param.params[1]);
+    int argument = std::get<int>(param.params[2]);
+    this->returnSystemCall(syscallUUID,
+                           host.fileControl(pid, fd, command, argument));
+    break;
+  }
+  case SystemCallInterface::SystemCall::POLL: {
+    struct pollfd *fds = (struct pollfd *)std::get<void *>(param.params[0]);
+    size_t count = std::get<uint64_t>(param.params[1]);
+    int timeout = std::get<int>(param.params[2]);
+    host.pollFileDescriptors(syscallUUID, pid, fds, count, timeout);
+    break;
+  }
+  case SystemCallInterface::SystemCall::EPOLL_CREATE: {
+    this->returnSystemCall(syscallUUID, host.epollCreate(pid));
+    break;
+  }
+  case SystemCallInterface::SystemCall::EPOLL_CTL: {
+    int epfd = std::get<int>(param.params[0]);
+    int operation = std::get<int>(param.params[1]);
+    auto *extra =
+        (const SystemCallParameter::ExtraParameters *)std::get<void *>(
+            param.params[2]);
+    int fd = std::get<int>((*extra)[0]);
+    auto *event = (const EpollEvent *)std::get<void *>((*extra)[1]);
+    this->returnSystemCall(
+        syscallUUID, host.epollControl(pid, epfd, operation, fd, event));
+    break;
+  }
+  case SystemCallInterface::SystemCall::EPOLL_WAIT: {
+    int epfd = std::get<int>(param.params[0]);
+    auto *events = (EpollEvent *)std::get<void *>(param.params[1]);
+    auto *extra =
+        (const SystemCallParameter::ExtraParameters *)std::get<void *>(
+            param.params[2]);
+    int maxEvents = std::get<int>((*extra)[0]);
+    int timeout = std::get<int>((*extra)[1]);
+    host.epollWait(syscallUUID, pid, epfd, events, maxEvents, timeout);
+    break;
+  }
   case SystemCallInterface::SystemCall::NSLEEP: {
-    addTimer(syscallUUID, std::get<uint64_t>(param.params[0]));
+    addTimer(SyscallTimer{SystemCallInterface::SystemCall::NSLEEP,
+                          syscallUUID, pid, -1},
+             std::get<uint64_t>(param.params[0]));
     break;
   }
   case SystemCallInterface::SystemCall::GETTIMEOFDAY: {
-    Time curTime =
-        static_cast<SystemCallInterface *>(this)->host.getCurrentTime();
+    Time curTime = host.getCurrentTime();
 
     struct timeval *tv = (struct timeval *)std::get<void *>(param.params[0]);
     struct timezone *tz = (struct timezone *)std::get<void *>(param.params[1]);
@@ -226,19 +585,50 @@ void Host::DefaultSystemCall::systemCallback(UUID syscallUUID, int pid,
     }
     break;
   }
-  default:
-    assert(0);
+  default: {
+    // Socket calls on an epoll instance fail like read(2) of one on Linux.
+    // Buffer descriptors are only the source of SENDFILE, and any other
+    // descriptor is unknown.
+    int fd = std::get<int>(param.params[0]);
+    bool epoll = host.processInfoMap.at(pid).epolls.count(fd) > 0;
+    this->returnSystemCall(syscallUUID, epoll ? -EINVAL : -EBADF);
+    break;
+  }
   }
 }
 
-HostModule::HostModule(std::string name, Host &host) : host(host), name(name) {}
+HostModule::HostModule(std::string name, Host &host)
+    : host(host), name(name) {
+  ModuleHandle handle = host.getModuleHandle(name);
+  host.handleModules[handle.getIndex()] = this;
+  host.moduleHandles[this] = handle;
+  // Until the current addHostModule says otherwise (see Host::namedDelivery)
+  host.namedDelivery[handle.getIndex()] = true;
+}
 HostModule::~HostModule() {}
 
 std::string HostModule::getHostModuleName() { return name; }
 
+ModuleHandle HostModule::getHostModuleHandle() const {
+  return host.moduleHandles.at(this);
+}
+
+void HostModule::packetArrived(ModuleHandle fromModule, Packet &&packet) {
+  packetArrived(host.getModuleHandleName(fromModule), std::move(packet));
+}
+
 void HostModule::sendPacket(std::string toModule, Packet &&packet) {
   host.sendPacketToModule(name, toModule, std::move(packet));
 }
+void HostModule::sendPacket(ModuleHandle toModule, Packet &&packet) {
+  host.sendPacketToModule(getHostModuleHandle(), toModule, std::move(packet));
+}
+ModuleHandle HostModule::getModuleHandle(const std::string &name) {
+  return host.getModuleHandle(name);
+}
+const std::string &HostModule::getModuleHandleName(ModuleHandle handle) {
+  return host.getModuleHandleName(handle);
+}
 void HostModule::sendPacket(std::string toModule, const Packet &packet) {
   sendPacket(toModule, Packet(packet));
 }
@@ -250,6 +640,12 @@ Size HostModule::getWireSpeed(int port_num) {
 
 size_t HostModule::getPortCount() { return host.getPortCount(); }
 
+bool HostModule::getChecksumOffload() { return host.getChecksumOffload(); }
+
+bool HostModule::isLoopbackAddress(const ipv4_t &ip) {
+  return host.isLoopbackAddress(ip);
+}
+
 void HostModule::print_log(uint64_t level, const char *format, ...) {
   va_list arglist;
   va_start(arglist, format);
@@ -261,6 +657,17 @@ SystemCallInterface::SystemCallInterface(int domain, int protocol, Host &host)
     : host(host), domain(domain), protocol(protocol) {}
 SystemCallInterface::~SystemCallInterface() {}
 
+bool SystemCallInterface::supportsSystemCall(SystemCall syscallNumber) const {
+  switch (syscallNumber) {
+  case READV:
+  case WRITEV:
+  case SENDFILE:
+    return false;
+  default:
+    return true;
+  }
+}
+
 void SystemCallInterface::returnSystemCall(UUID syscallUUID, int val) {
   host.returnSystemCall(syscallUUID, val);
 }
@@ -272,13 +679,42 @@ void SystemCallInterface::removeFileDescriptor(int processID, int fd) {
   return host.removeFileDescriptor(processID, fd);
 }
 
+void SystemCallInterface::setFileDescriptorEvents(int processID, int fd,
+                                                  short events) {
+  host.setFileDescriptorEvents(processID, fd, events);
+}
+
+bool SystemCallInterface::isNonBlocking(int processID, int fd) {
+  return host.isNonBlocking(processID, fd);
+}
+
+std::optional<SystemCallInterface::SharedBuffer>
+SystemCallInterface::getSharedBuffer(int processID, int fd) {
+  return host.getSharedBuffer(processID, fd);
+}
+
 void Host::sendPacketToModule(std::optional<std::string> fromModule,
                               std::string toModule, Packet &&packet) {
-  auto it = hostModuleMap.find(toModule);
+  auto to = handleMap.find(toModule);
+  if (to == handleMap.end()) {
+    print_log(MODULE_ERROR, "No module named [%s] has found. Drop packet.",
+              toModule.c_str());
+    return;
+  }
+  ModuleHandle from =
+      fromModule.has_value() ? getModuleHandle(*fromModule) : HOST_HANDLE;
+  sendPacketToModule(from, to->second, std::move(packet));
+}
 
-  if (toModule.compare("Host") == 0) {
-    mac_t my_mac;
-    packet.readData(6, my_mac.data(), 6);
+void Host::sendPacketToModule(ModuleHandle fromModule, ModuleHandle toModule,
+                              Packet &&packet) {
+  assert(toModule.getIndex() < handleModules.size());
+  if (toModule == LOOPBACK_HANDLE) {
+    loopBack(fromModule, std::move(packet));
+  } else if (toModule == HOST_HANDLE) {
+    ConstEthernetHeaderView ethernet(packet);
+    assert(ethernet);
+    mac_t my_mac = ethernet.getSource();
 
     int selected_port = 0;
     for (size_t k = 0; k < this->ports.size(); k++) {
@@ -289,35 +725,120 @@ void Host::sendPacketToModule(std::optional<std::string> fromModule,
       }
     }
     this->sendPacket(selected_port, std::move(packet));
-  } else if (it == hostModuleMap.end()) {
+  } else if (handleModules[toModule.getIndex()] == nullptr) {
     print_log(MODULE_ERROR, "No module named [%s] has found. Drop packet.",
-              toModule.c_str());
+              getModuleHandleName(toModule).c_str());
   } else {
-    auto hostMessage = std::make_unique<PacketPass>(
-        std::move(fromModule), std::move(toModule), std::move(packet));
+    UUID messageID;
+    if (!hopQueueScheduled) {
+      hopQueueScheduled = true;
+      // DELAY module packet transfer delay
+      messageID = this->sendMessageSelf(std::make_unique<PacketPass>(), 0);
+    } else {
+      messageID = this->reserveMessageID();
+    }
+    hopQueue.push_back({fromModule, toModule, std::move(packet), messageID});
+  }
+}
 
-    this->sendMessageSelf(std::move(hostMessage),
-                          0); // DELAY module packet transfer delay
+void Host::deliverPacketHops() {
+  while (!hopQueue.empty()) {
+    if (hasMessageBefore(hopQueue.front().messageID)) {
+      sendReservedMessageSelf(std::make_unique<PacketPass>(),
+                              hopQueue.front().messageID);
+      return;
+    }
+
+    PacketHop hop = std::move(hopQueue.front());
+    hopQueue.pop_front();
+    if (this->running == true) {
+      HostModule *module = handleModules[hop.to.getIndex()];
+      assert(module);
+      if (namedDelivery[hop.to.getIndex()])
+        module->packetArrived(getModuleHandleName(hop.from),
+                              std::move(hop.packet));
+      else
+        module->packetArrived(hop.from, std::move(hop.packet));
+    }
   }
+  hopQueueScheduled = false;
 }
 
-UUID Host::addTimer(std::string fromModule, std::any payload, Time timeAfter) {
-  auto timerMessage = std::make_unique<Timer>(fromModule, payload);
+UUID Host::addTimer(TimerModule *module, std::any payload, Time timeAfter) {
+  auto timerMessage = std::make_unique<Timer>(module, std::move(payload));
   return this->sendMessageSelf(std::move(timerMessage), timeAfter);
 }
 
+UUID Host::addTimer(std::unique_ptr<TimerModule::TimerEvent> event,
+                    Time timeAfter) {
+  return this->sendMessageSelf(std::move(event), timeAfter);
+}
+
 void Host::cancelTimer(UUID key) { this->cancelMessage(key); }
 
 UUID Host::issueSystemCall(
     int pid, const SystemCallInterface::SystemCallParameter &param) {
 
   auto hostMessage = std::make_unique<Syscall>(pid, param);
+  Time delay = cpuModel.has_value()
+                   ? chargeCPU(selectCore(pid), cpuModel->perSyscall)
+                   : 0;
+
+  return this->sendMessageSelf(std::move(hostMessage), delay);
+}
 
-  return this->sendMessageSelf(std::move(hostMessage), 0);
+void Host::issueSystemCalls(
+    int pid, std::vector<SystemCallApplication::Submission> &&submissions) {
+  // Each call is charged and delivered on its own, as if the process had
+  // issued them one after another.
+  ProcessInfo &procInfo = processInfoMap.at(pid);
+  for (auto &submission : submissions) {
+    Time delay = cpuModel.has_value()
+                     ? chargeCPU(selectCore(pid), cpuModel->perSyscall)
+                     : 0;
+    auto hostMessage =
+        std::make_unique<SubmittedSyscall>(pid, std::move(submission));
+    SubmittedSyscall &syscall = *hostMessage;
+    syscall.messageID = this->sendMessageSelf(std::move(hostMessage), delay);
+    procInfo.submitted.insert(syscall.messageID);
+  }
+}
+
+void Host::exitSystemCalls(int pid) {
+  ProcessInfo &procInfo = processInfoMap.at(pid);
+
+  // Submitted calls which have not reached their interfaces are dropped.
+  for (UUID messageID : procInfo.submitted)
+    this->cancelMessage(messageID);
+  procInfo.submitted.clear();
+
+  // Blocked POLL and EPOLL_WAIT calls no longer time out.
+  for (auto &waiter : procInfo.pollWaiters)
+    if (waiter.timer.has_value())
+      cancelTimer(waiter.timer.value());
+  for (auto &[epfd, epoll] : procInfo.epolls)
+    for (auto &waiter : epoll.waiters)
+      if (waiter.timer.has_value())
+        cancelTimer(waiter.timer.value());
+
+  // Calls which are still in progress are forgotten. When their interfaces
+  // return them, returnSystemCall finds nothing to complete.
+  std::vector<UUID> unfinished;
+  syscallMap.forEach([&](UUID syscallUUID, const PendingSyscall &pending) {
+    if (pending.pid == pid)
+      unfinished.push_back(syscallUUID);
+  });
+  for (UUID syscallUUID : unfinished) {
+    print_log(SYSCALL_ERROR,
+              "Unfinished system call [%" PRIu64 "] of app[pid:%d] at %s",
+              syscallUUID, pid, this->getModuleName().c_str());
+    syscallMap.erase(syscallUUID);
+  }
 }
 
 void Host::returnSystemCall(UUID syscallUUID, int val) {
-  if (syscallMap.find(syscallUUID) == syscallMap.end()) {
+  PendingSyscall *pending = syscallMap.find(syscallUUID);
+  if (pending == nullptr) {
     print_log(NetworkLog::SYSCALL_ERROR,
               "Invalid System call [%" PRIu64 "] at [%s].", syscallUUID,
               this->getModuleName().c_str());
@@ -329,35 +850,58 @@ void Host::returnSystemCall(UUID syscallUUID, int val) {
             "] at [%s] has finished with return value [%d].",
             syscallUUID, this->getModuleName().c_str(), val);
 
-  auto iter = syscallMap.find(syscallUUID);
-  auto app = processInfoMap[iter->second].application;
+  auto procIter = processInfoMap.find(pending->pid);
+  if (procIter == processInfoMap.end()) {
+    syscallMap.erase(syscallUUID);
+    return;
+  }
+  auto app = procIter->second.application;
+
+  // Scatter what an emulated READV has read (see emulateSystemCall).
+  EmulatedSyscall *emulated = pending->emulated.get();
+  if (emulated != nullptr && emulated->iov != nullptr && val > 0) {
+    size_t done = 0;
+    for (int k = 0; k < emulated->iovcnt && done < (size_t)val; k++) {
+      size_t length = std::min(emulated->iov[k].iov_len, (size_t)val - done);
+      memcpy(emulated->iov[k].iov_base, &emulated->bounce[done], length);
+      done += length;
+    }
+  }
 
-  app->returnSyscall(val);
-  networkSystem.addRunnable(app);
-  syscallMap.erase(iter);
+  if (pending->userData.has_value()) {
+    app->completeSyscall(pending->userData.value(), val);
+    // Wake the application once enough completions are ready.
+    if (app->completionsWanted > 0 &&
+        app->completions.size() >= app->completionsWanted) {
+      app->completionsWanted = 0;
+      app->ready();
+      networkSystem.addRunnable(app);
+    }
+  } else {
+    app->returnSyscall(val);
+    networkSystem.addRunnable(app);
+  }
+  syscallMap.erase(syscallUUID);
 }
 
 int Host::createFileDescriptor(int domain, int protocol, int processID) {
   assert(processInfoMap.find(processID) != processInfoMap.end());
   ProcessInfo &procInfo = processInfoMap.find(processID)->second;
-  int current = 3;
   // assert(procInfo.fdSet.find(processID) != procInfo.fdSet.end());
 
-  auto it = procInfo.fdToDomain.begin();
-
-  while (it != procInfo.fdToDomain.end() && it->first == current) {
-    ++current;
-    ++it;
-  }
-
-  if (current >= MAX_FD) {
+  // lowest unused fd after stdin, stdout and stderr
+  auto fd = procInfo.fdBitmap.findFree(3);
+  if (!fd.has_value()) {
 
     print_log(NetworkLog::SYSCALL_ERROR, "Out of FD for process %d.",
               processID);
     return -1;
   }
+  int current = (int)fd.value();
+  procInfo.fdBitmap.set(current);
   procInfo.fdToDomain.insert(
       std::pair<int, Namespace>(current, Namespace(domain, protocol)));
+  procInfo.fdState.insert({current, FileDescriptorState()});
 
   return current;
 }
@@ -367,31 +911,333 @@ void Host::removeFileDescriptor(int processID, int fd) {
   if (processInfoMap.find(processID) != processInfoMap.end()) {
     ProcessInfo &procInfo = processInfoMap.find(processID)->second;
 
-    procInfo.fdToDomain.erase(fd);
+    if (procInfo.fdToDomain.erase(fd) > 0)
+      procInfo.fdBitmap.reset(fd);
+
+    auto stateIter = procInfo.fdState.find(fd);
+    if (stateIter != procInfo.fdState.end()) {
+      // Closing a descriptor removes it from every epoll instance.
+      for (int epfd : stateIter->second.epolls) {
+        EpollInstance &instance = procInfo.epolls.at(epfd);
+        instance.interest.erase(fd);
+        instance.ready.erase(fd);
+      }
+      procInfo.fdState.erase(stateIter);
+    }
   }
 }
 
-int Host::registerProcess(std::shared_ptr<SystemCallApplication> app) {
-  int start = pidStart;
-  int current = start;
-  do {
-    if (processInfoMap.find(current) == processInfoMap.end()) {
-      ProcessInfo procInfo;
-      app->pid = current;
-      procInfo.application = std::move(app);
-      processInfoMap.insert(
-          std::pair<int, ProcessInfo>(current, std::move(procInfo)));
-      pidStart = (current + 1) % MAX_PID;
-
-      // found proper fd number
-      return current;
+void Host::setFileDescriptorEvents(int processID, int fd, short events) {
+  auto procIter = processInfoMap.find(processID);
+  if (procIter == processInfoMap.end())
+    return;
+  ProcessInfo &procInfo = procIter->second;
+  auto stateIter = procInfo.fdState.find(fd);
+  if (stateIter == procInfo.fdState.end())
+    return;
+  FileDescriptorState &state = stateIter->second;
+  if (state.events == events)
+    return;
+  state.events = events;
+
+  updateEpollReady(procInfo, fd);
+
+  for (auto iter = procInfo.pollWaiters.begin();
+       iter != procInfo.pollWaiters.end();) {
+    size_t ready = collectPollEvents(procInfo, (struct pollfd *)iter->events,
+                                     iter->count);
+    if (ready == 0) {
+      ++iter;
+      continue;
     }
+    PollWaiter waiter = *iter;
+    iter = procInfo.pollWaiters.erase(iter);
+    if (waiter.timer.has_value())
+      cancelTimer(waiter.timer.value());
+    returnSystemCall(waiter.syscallUUID, (int)ready);
+  }
+}
 
-    current = (current + 1) % MAX_FD;
-  } while (start != current);
+bool Host::isNonBlocking(int processID, int fd) {
+  auto procIter = processInfoMap.find(processID);
+  if (procIter == processInfoMap.end())
+    return false;
+  auto stateIter = procIter->second.fdState.find(fd);
+  return stateIter != procIter->second.fdState.end() &&
+         (stateIter->second.flags & O_NONBLOCK) != 0;
+}
 
-  print_log(NetworkLog::SYSCALL_ERROR, "Out of PID.");
-  return -1;
+int Host::fileControl(int pid, int fd, int command, int argument) {
+  ProcessInfo &procInfo = processInfoMap.at(pid);
+  auto stateIter = procInfo.fdState.find(fd);
+  if (stateIter == procInfo.fdState.end())
+    return -EBADF;
+  switch (command) {
+  case F_GETFL:
+    return O_RDWR | stateIter->second.flags;
+  case F_SETFL:
+    stateIter->second.flags = argument & O_NONBLOCK;
+    return 0;
+  default:
+    return -EINVAL;
+  }
+}
+
+size_t Host::collectPollEvents(ProcessInfo &procInfo, struct pollfd *fds,
+                               size_t count) {
+  size_t ready = 0;
+  for (size_t k = 0; k < count; k++) {
+    fds[k].revents = 0;
+    if (fds[k].fd < 0)
+      continue;
+    auto stateIter = procInfo.fdState.find(fds[k].fd);
+    if (stateIter == procInfo.fdState.end())
+      fds[k].revents = POLLNVAL;
+    else
+      fds[k].revents =
+          stateIter->second.events & (fds[k].events | POLLERR | POLLHUP);
+    if (fds[k].revents != 0)
+      ready++;
+  }
+  return ready;
+}
+
+void Host::pollFileDescriptors(UUID syscallUUID, int pid, struct pollfd *fds,
+                               size_t count, int timeout) {
+  ProcessInfo &procInfo = processInfoMap.at(pid);
+  size_t ready = collectPollEvents(procInfo, fds, count);
+  if (ready > 0 || timeout == 0) {
+    returnSystemCall(syscallUUID, (int)ready);
+    return;
+  }
+
+  PollWaiter waiter{syscallUUID, fds, count, {}};
+  if (timeout > 0)
+    waiter.timer = defaultSystemCall->addTimer(
+        SyscallTimer{SystemCallInterface::SystemCall::POLL, syscallUUID, pid,
+                     -1},
+        TimeUtil::makeTime(timeout, TimeUtil::MSEC));
+  procInfo.pollWaiters.push_back(waiter);
+}
+
+int Host::epollCreate(int pid) {
+  int epfd = createFileDescriptor(0, 0, pid);
+  if (epfd < 0)
+    return -EMFILE;
+  processInfoMap.at(pid).epolls.insert({epfd, EpollInstance()});
+  return epfd;
+}
+
+void Host::updateEpollReady(ProcessInfo &procInfo, int fd) {
+  FileDescriptorState &state = procInfo.fdState.at(fd);
+  for (int epfd : state.epolls) {
+    EpollInstance &instance = procInfo.epolls.at(epfd);
+    uint32_t wanted = instance.interest.at(fd).events | POLLERR | POLLHUP;
+    if ((state.events & wanted) == 0) {
+      instance.ready.erase(fd);
+      continue;
+    }
+    instance.ready.insert(fd);
+    while (!instance.ready.empty() && !instance.waiters.empty()) {
+      PollWaiter waiter = instance.waiters.front();
+      instance.waiters.pop_front();
+      if (waiter.timer.has_value())
+        cancelTimer(waiter.timer.value());
+      size_t ready =
+          collectEpollEvents(procInfo, instance,
+                             (SystemCallInterface::EpollEvent *)waiter.events,
+                             waiter.count);
+      returnSystemCall(waiter.syscallUUID, (int)ready);
+    }
+  }
+}
+
+int Host::epollControl(int pid, int epfd, int operation, int fd,
+                       const SystemCallInterface::EpollEvent *event) {
+  ProcessInfo &procInfo = processInfoMap.at(pid);
+  auto epollIter = procInfo.epolls.find(epfd);
+  auto stateIter = procInfo.fdState.find(fd);
+  if (procInfo.fdState.count(epfd) == 0 || stateIter == procInfo.fdState.end())
+    return -EBADF;
+  // Nested epoll instances are not supported.
+  if (epollIter == procInfo.epolls.end() || procInfo.epolls.count(fd) > 0)
+    return -EINVAL;
+
+  EpollInstance &instance = epollIter->second;
+  FileDescriptorState &state = stateIter->second;
+  bool watched = instance.interest.count(fd) > 0;
+  switch (operation) {
+  case SystemCallInterface::EPOLL_ADD:
+    if (watched)
+      return -EEXIST;
+    if (event == nullptr)
+      return -EFAULT;
+    instance.interest[fd] = *event;
+    state.epolls.push_back(epfd);
+    break;
+  case SystemCallInterface::EPOLL_MOD:
+    if (!watched)
+      return -ENOENT;
+    if (event == nullptr)
+      return -EFAULT;
+    instance.interest[fd] = *event;
+    break;
+  case SystemCallInterface::EPOLL_DEL:
+    if (!watched)
+      return -ENOENT;
+    instance.interest.erase(fd);
+    instance.ready.erase(fd);
+    state.epolls.erase(
+        std::find(state.epolls.begin(), state.epolls.end(), epfd));
+    return 0;
+  default:
+    return -EINVAL;
+  }
+  updateEpollReady(procInfo, fd);
+  return 0;
+}
+
+size_t Host::collectEpollEvents(ProcessInfo &procInfo, EpollInstance &instance,
+                                SystemCallInterface::EpollEvent *events,
+                                size_t count) {
+  // Start after the last reported descriptor, so every ready descriptor is
+  // reported even if more are ready than fit.
+  size_t ready = 0;
+  auto iter = instance.ready.lower_bound(instance.cursor);
+  for (size_t k = 0; k < instance.ready.size() && ready < count; k++) {
+    if (iter == instance.ready.end())
+      iter = instance.ready.begin();
+    int fd = *iter++;
+    const SystemCallInterface::EpollEvent &interest = instance.interest.at(fd);
+    events[ready].events = procInfo.fdState.at(fd).events &
+                           (interest.events | POLLERR | POLLHUP);
+    events[ready].data = interest.data;
+    ready++;
+    instance.cursor = fd + 1;
+  }
+  return ready;
+}
+
+void Host::epollWait(UUID syscallUUID, int pid, int epfd,
+                     SystemCallInterface::EpollEvent *events, int maxEvents,
+                     int timeout) {
+  ProcessInfo &procInfo = processInfoMap.at(pid);
+  auto epollIter = procInfo.epolls.find(epfd);
+  if (epollIter == procInfo.epolls.end()) {
+    returnSystemCall(syscallUUID,
+                     procInfo.fdState.count(epfd) == 0 ? -EBADF : -EINVAL);
+    return;
+  }
+  if (maxEvents <= 0) {
+    returnSystemCall(syscallUUID, -EINVAL);
+    return;
+  }
+
+  EpollInstance &instance = epollIter->second;
+  if (!instance.ready.empty() || timeout == 0) {
+    returnSystemCall(syscallUUID, (int)collectEpollEvents(procInfo, instance,
+                                                          events, maxEvents));
+    return;
+  }
+
+  PollWaiter waiter{syscallUUID, events, (size_t)maxEvents, {}};
+  if (timeout > 0)
+    waiter.timer = defaultSystemCall->addTimer(
+        SyscallTimer{SystemCallInterface::SystemCall::EPOLL_WAIT, syscallUUID,
+                     pid, epfd},
+        TimeUtil::makeTime(timeout, TimeUtil::MSEC));
+  instance.waiters.push_back(waiter);
+}
+
+int Host::epollClose(int pid, int epfd) {
+  ProcessInfo &procInfo = processInfoMap.at(pid);
+  auto epollIter = procInfo.epolls.find(epfd);
+  if (epollIter == procInfo.epolls.end())
+    return -EBADF;
+
+  EpollInstance &instance = epollIter->second;
+  for (auto &[fd, interest] : instance.interest) {
+    (void)interest;
+    auto &epolls = procInfo.fdState.at(fd).epolls;
+    epolls.erase(std::find(epolls.begin(), epolls.end(), epfd));
+  }
+  for (PollWaiter &waiter : instance.waiters) {
+    if (waiter.timer.has_value())
+      cancelTimer(waiter.timer.value());
+    returnSystemCall(waiter.syscallUUID, -EBADF);
+  }
+  procInfo.epolls.erase(epollIter);
+  removeFileDescriptor(pid, epfd);
+  return 0;
+}
+
+int Host::bufferCreate(int pid, const void *data, size_t length) {
+  if (data == nullptr && length > 0)
+    return -EFAULT;
+  int fd = createFileDescriptor(0, 0, pid);
+  if (fd < 0)
+    return -EMFILE;
+  // The only copy: SENDFILE attaches the buffer to Packets by reference.
+  SystemCallInterface::SharedBuffer shared{
+      PacketBuffer::allocate(std::max<size_t>(length, 1), false), length};
+  if (length > 0)
+    memcpy(shared.buffer.data(), data, length);
+  processInfoMap.at(pid).buffers.insert({fd, std::move(shared)});
+  return fd;
+}
+
+std::optional<SystemCallInterface::SharedBuffer>
+Host::getSharedBuffer(int pid, int fd) {
+  auto procIter = processInfoMap.find(pid);
+  if (procIter == processInfoMap.end())
+    return {};
+  auto bufferIter = procIter->second.buffers.find(fd);
+  if (bufferIter == procIter->second.buffers.end())
+    return {};
+  return bufferIter->second;
+}
+
+void Host::pollTimedOut(const SyscallTimer &timer) {
+  auto procIter = processInfoMap.find(timer.pid);
+  if (procIter == processInfoMap.end())
+    return;
+  ProcessInfo &procInfo = procIter->second;
+
+  std::list<PollWaiter> *waiters = &procInfo.pollWaiters;
+  if (timer.epfd >= 0) {
+    auto epollIter = procInfo.epolls.find(timer.epfd);
+    if (epollIter == procInfo.epolls.end())
+      return;
+    waiters = &epollIter->second.waiters;
+  }
+  for (auto iter = waiters->begin(); iter != waiters->end(); ++iter) {
+    if (iter->syscallUUID == timer.syscallUUID) {
+      waiters->erase(iter);
+      returnSystemCall(timer.syscallUUID, 0);
+      return;
+    }
+  }
+}
+
+int Host::registerProcess(std::shared_ptr<SystemCallApplication> app) {
+  // PIDs are assigned in turn, skipping running processes.
+  auto pid = pidBitmap.findFree(pidStart, true);
+  if (!pid.has_value()) {
+    print_log(NetworkLog::SYSCALL_ERROR, "Out of PID.");
+    return -1;
+  }
+
+  int current = (int)pid.value();
+  assert(processInfoMap.find(current) == processInfoMap.end());
+  ProcessInfo procInfo;
+  app->pid = current;
+  procInfo.application = std::move(app);
+  processInfoMap.insert(
+      std::pair<int, ProcessInfo>(current, std::move(procInfo)));
+  pidBitmap.set(current);
+  pidStart = (current + 1) % MAX_PID;
+
+  return current;
 }
 
 void Host::launchApplication(int pid) {
@@ -406,6 +1252,10 @@ Size Host::getWireSpeed(int port_num) {
   return networkSystem.getWireSpeed(ports[port_num]);
 }
 
+void Host::setChecksumOffload(bool enable) { checksumOffload = enable; }
+
+bool Host::getChecksumOffload() const { return checksumOffload; }
+
 void Host::exitProcess(int pid, int returnValue) {
 
   auto retMessage = std::make_unique<Return>(pid, returnValue);
@@ -443,6 +1293,51 @@ void SystemCallApplication::returnSyscall(int retVal) {
   syscallRet = retVal;
   ready();
 }
+
+void SystemCallApplication::E_SyscallPrepare(
+    const SystemCallInterface::SystemCallParameter &param, uint64_t userData) {
+  submissions.push_back({param, userData});
+}
+
+size_t SystemCallApplication::E_SyscallSubmit(size_t waitFor) {
+  size_t submitted = submissions.size();
+  if (submitted > 0) {
+    syscallsInFlight += submitted;
+    if (this->host.isRunning()) {
+      host.issueSystemCalls(pid, std::move(submissions));
+    } else {
+      for (auto &submission : submissions)
+        completeSyscall(submission.userData, -1);
+    }
+    submissions.clear();
+  }
+
+  waitFor = std::min(waitFor, syscallsInFlight + completions.size());
+  if (completions.size() < waitFor) {
+    completionsWanted = waitFor;
+    wait();
+  }
+  return submitted;
+}
+
+size_t SystemCallApplication::E_SyscallReap(Completion *completions,
+                                            size_t count) {
+  size_t reaped = std::min(count, this->completions.size());
+  std::copy_n(this->completions.begin(), reaped, completions);
+  this->completions.erase(this->completions.begin(),
+                          this->completions.begin() + reaped);
+  return reaped;
+}
+
+size_t SystemCallApplication::getSyscallsInFlight() const {
+  return syscallsInFlight + completions.size();
+}
+
+void SystemCallApplication::completeSyscall(uint64_t userData, int result) {
+  assert(syscallsInFlight > 0);
+  syscallsInFlight--;
+  completions.push_back({userData, result});
+}
 Time SystemCallApplication::getCurrentTime() { return host.getCurrentTime(); }
 
 } // namespace E
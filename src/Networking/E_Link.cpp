@@ -7,9 +7,11 @@
 
 #include <E/E_Common.hpp>
 #include <E/E_TimeUtil.hpp>
+#include <E/Networking/E_HeaderView.hpp>
 #include <E/Networking/E_Link.hpp>
 #include <E/Networking/E_Networking.hpp>
 #include <E/Networking/E_Packet.hpp>
+#include <E/Networking/E_PacketTracker.hpp>
 #include <E/Networking/E_Wire.hpp>
 
 namespace E {
@@ -26,9 +28,19 @@ Module::Message Link::messageReceived(const ModuleID from,
   if (typeid(message) == typeid(Wire::Message &)) {
     Wire::Message &portMessage = dynamic_cast<Wire::Message &>(message);
 
+    stampIngress(from, portMessage.packet);
     this->packetArrived(from, std::move(portMessage.packet));
   }
 
+  if (typeid(message) == typeid(Wire::BatchMessage &)) {
+    Wire::BatchMessage &batchMessage =
+        dynamic_cast<Wire::BatchMessage &>(message);
+
+    for (size_t k = 0; k < batchMessage.batch.size(); k++)
+      stampIngress(from, batchMessage.batch[k]);
+    this->packetsArrived(from, std::move(batchMessage.batch));
+  }
+
   if (typeid(message) == typeid(Link::Message &)) {
     Link::Message &selfMessage = dynamic_cast<Link::Message &>(message);
     if (selfMessage.type == CHECK_QUEUE) {
@@ -38,9 +50,36 @@ Module::Message Link::messageReceived(const ModuleID from,
       Time current_time = this->getCurrentTime();
       Time &avail_time = this->nextAvailable[wireID];
 
-      if (current_time >= avail_time) {
-        Packet packet = current_queue.front();
+      if (current_time >= avail_time && this->bps == 0 && this->batching &&
+          current_queue.size() > 1) {
+        // Without transmission delay, every queued packet leaves now.
+        PacketBatch batch(current_time);
+        while (!current_queue.empty() && !batch.full()) {
+          PACKET_TRACE(PacketTracker::stamp(
+              current_queue.front(), PacketTracker::LINK_DEQUEUE, this));
+          writePCAP(current_queue.front(), current_time);
+          batch.push(std::move(current_queue.front()));
+          current_queue.pop_front();
+        }
+        print_log(NetworkLog::PACKET_QUEUE,
+                  "Output queue length for port[%s] decreased to [%zu]",
+                  this->getModuleName(wireID).c_str(), current_queue.size());
+
+        avail_time = current_time;
+        auto batchMessage = std::make_unique<Wire::BatchMessage>(
+            Wire::PACKET_TO_PORT, std::move(batch));
+        this->sendMessage(wireID, std::move(batchMessage), 0);
+
+        if (current_queue.size() > 0) {
+          auto selfMessage =
+              std::make_unique<Link::Message>(Link::CHECK_QUEUE, wireID);
+          this->sendMessageSelf(std::move(selfMessage), 0);
+        }
+      } else if (current_time >= avail_time) {
+        Packet packet = std::move(current_queue.front());
         current_queue.pop_front();
+        PACKET_TRACE(
+            PacketTracker::stamp(packet, PacketTracker::LINK_DEQUEUE, this));
 
         print_log(NetworkLog::PACKET_QUEUE,
                   "Output queue length for port[%s] decreased to [%zu]",
@@ -51,27 +90,12 @@ Module::Message Link::messageReceived(const ModuleID from,
           trans_delay = (((Real)packet.getSize() * 8 * (1000 * 1000 * 1000UL)) /
                          (Real)this->bps);
 
-        auto portMessage2 = std::make_unique<Wire::Message>(
-            Wire::PACKET_TO_PORT, Packet(packet)); // explicit copy for pcap
-
         avail_time = current_time + trans_delay;
 
-        if (pcap_enabled) {
-          struct pcap_packet_header pcap_header;
-          memset(&pcap_header, 0, sizeof(pcap_header));
-          pcap_header.ts_sec = TimeUtil::getTime(current_time, TimeUtil::SEC);
-          pcap_header.ts_usec =
-              (TimeUtil::getTime(current_time, TimeUtil::NSEC) % 1000000000);
-          pcap_header.incl_len = std::min(snaplen, packet.getSize());
-          pcap_header.orig_len = packet.getSize();
-          // nanosecond precision
-          pcap_file.write((char *)&pcap_header, sizeof(pcap_header));
-
-          std::vector<char> temp_buffer(pcap_header.incl_len);
-          packet.readData(0, temp_buffer.data(), pcap_header.incl_len);
-          pcap_file.write(temp_buffer.data(), pcap_header.incl_len);
-        }
+        writePCAP(packet, current_time);
 
+        auto portMessage2 = std::make_unique<Wire::Message>(
+            Wire::PACKET_TO_PORT, std::move(packet));
         this->sendMessage(wireID, std::move(portMessage2), trans_delay);
 
         if (current_queue.size() > 0) {
@@ -90,6 +114,37 @@ Module::Message Link::messageReceived(const ModuleID from,
 
   return nullptr;
 }
+void Link::writePCAP(const Packet &packet, Time time) {
+  if (!pcap_enabled)
+    return;
+
+  struct pcap_packet_header pcap_header;
+  memset(&pcap_header, 0, sizeof(pcap_header));
+  pcap_header.ts_sec = TimeUtil::getTime(time, TimeUtil::SEC);
+  pcap_header.ts_usec = (TimeUtil::getTime(time, TimeUtil::NSEC) % 1000000000);
+  pcap_header.incl_len = std::min(snaplen, packet.getSize());
+  pcap_header.orig_len = packet.getSize();
+  // nanosecond precision
+  pcap_file.write((char *)&pcap_header, sizeof(pcap_header));
+
+  auto write = [&](const char *data, size_t length) {
+    pcap_file.write(data, length);
+  };
+  if (packet.getMetadata().offload != 0) {
+    // Capture the frame as the wire would carry it.
+    Packet complete = packet;
+    completeChecksums(complete);
+    complete.visitData(0, pcap_header.incl_len, write);
+  } else {
+    packet.visitData(0, pcap_header.incl_len, write);
+  }
+}
+
+void Link::packetsArrived(const ModuleID inWireID, PacketBatch &&batch) {
+  for (size_t k = 0; k < batch.size(); k++)
+    this->packetArrived(inWireID, std::move(batch[k]));
+}
+
 void Link::messageFinished(const ModuleID to, Module::Message message,
                            Module::MessageBase &response) {
   (void)to;
@@ -120,19 +175,17 @@ void Link::sendPacket(const ModuleID port, Packet &&packet) {
         ++iter;
       }
       assert(iter != current_queue.end());
-      Packet toBeRemoved = *iter;
-      current_queue.erase(iter);
-
       print_log(NetworkLog::PACKET_QUEUE,
                 "Output queue for port[%s] is full, remove at %zu, packet "
                 "length: %zu",
-                this->getModuleName(port).c_str(), index,
-                toBeRemoved.getSize());
+                this->getModuleName(port).c_str(), index, iter->getSize());
+      current_queue.erase(iter);
     }
   }
   assert(this->max_queue_length == 0 ||
          current_queue.size() < this->max_queue_length);
-  current_queue.push_back(packet);
+  PACKET_TRACE(PacketTracker::stamp(packet, PacketTracker::LINK_ENQUEUE, this));
+  current_queue.push_back(std::move(packet));
   print_log(NetworkLog::PACKET_QUEUE,
             "Output queue length for port[%s] increased to [%zu]",
             this->getModuleName(port).c_str(), current_queue.size());
@@ -151,10 +204,13 @@ void Link::setQueueSize(Size max_queue_length) {
   this->max_queue_length = max_queue_length;
 }
 
+void Link::setBatching(bool batching) { this->batching = batching; }
+
 Link::Link(std::string name, NetworkSystem &system)
     : NetworkModule(system), NetworkLog(static_cast<System &>(system)) {
   this->bps = 1000000000;
   this->max_queue_length = 0;
+  this->batching = true;
   this->pcap_enabled = false;
   this->snaplen = 65535;
 }
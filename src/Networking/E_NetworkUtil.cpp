@@ -7,13 +7,224 @@
 
 #include <E/Networking/E_NetworkUtil.hpp>
 #include <arpa/inet.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define E_SUM_X86
+#endif
 
 namespace E {
 
 NetworkUtil::NetworkUtil() {}
 NetworkUtil::~NetworkUtil() {}
 
+/*
+ * The ones' complement sum does not depend on byte order (RFC 1071), so the
+ * word kernels add native-order words into a 64-bit accumulator with
+ * end-around carry and swap the folded result on little-endian hosts.
+ * A trailing odd byte is the high byte of a network-order word.
+ */
+
+static inline uint64_t add_carry(uint64_t sum, uint64_t value) {
+  sum += value;
+  return sum + (sum < value);
+}
+
+static uint16_t fold_native(uint64_t sum) {
+  sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+  sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  uint16_t result = (uint16_t)sum;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  result = (uint16_t)((result >> 8) | (result << 8));
+#endif
+  return result;
+}
+
+/*
+ * Each kernel optionally copies the summed bytes to destination, so that
+ * copy_and_sum reads its source only once.
+ */
+
+template <bool copy>
+static uint64_t sum_word64(const uint8_t *buffer, size_t size, uint64_t sum,
+                           uint8_t *destination) {
+  for (; size >= 8; buffer += 8, size -= 8) {
+    uint64_t value;
+    memcpy(&value, buffer, sizeof(value));
+    sum = add_carry(sum, value);
+    if constexpr (copy) {
+      memcpy(destination, &value, sizeof(value));
+      destination += 8;
+    }
+  }
+  if (size >= 4) {
+    uint32_t value;
+    memcpy(&value, buffer, sizeof(value));
+    sum = add_carry(sum, value);
+    if constexpr (copy) {
+      memcpy(destination, &value, sizeof(value));
+      destination += 4;
+    }
+    buffer += 4;
+    size -= 4;
+  }
+  if (size >= 2) {
+    uint16_t value;
+    memcpy(&value, buffer, sizeof(value));
+    sum = add_carry(sum, value);
+    if constexpr (copy) {
+      memcpy(destination, &value, sizeof(value));
+      destination += 2;
+    }
+    buffer += 2;
+    size -= 2;
+  }
+  if (size == 1) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    sum = add_carry(sum, buffer[0]);
+#else
+    sum = add_carry(sum, (uint64_t)buffer[0] << 8);
+#endif
+    if constexpr (copy)
+      destination[0] = buffer[0];
+  }
+  return sum;
+}
+
+#ifdef E_SUM_X86
+// A 32-bit lane gains at most two 16-bit words per block,
+// so it cannot overflow within this many blocks.
+static constexpr size_t sum_blocks_max = 32768;
+
+template <bool copy>
+__attribute__((target("sse2"))) static uint64_t
+sum_sse2(const uint8_t *buffer, size_t size, uint64_t sum,
+         uint8_t *destination) {
+  const __m128i zero = _mm_setzero_si128();
+  while (size >= 16) {
+    size_t blocks = std::min(size / 16, sum_blocks_max);
+    __m128i acc = zero;
+    for (size_t k = 0; k < blocks; k++, buffer += 16) {
+      __m128i value = _mm_loadu_si128((const __m128i *)buffer);
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(value, zero));
+      acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(value, zero));
+      if constexpr (copy) {
+        _mm_storeu_si128((__m128i *)destination, value);
+        destination += 16;
+      }
+    }
+    size -= blocks * 16;
+
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    for (uint32_t lane : lanes)
+      sum = add_carry(sum, lane);
+  }
+  return sum_word64<copy>(buffer, size, sum, destination);
+}
+
+template <bool copy>
+__attribute__((target("avx2"))) static uint64_t
+sum_avx2(const uint8_t *buffer, size_t size, uint64_t sum,
+         uint8_t *destination) {
+  const __m256i zero = _mm256_setzero_si256();
+  while (size >= 32) {
+    size_t blocks = std::min(size / 32, sum_blocks_max);
+    __m256i acc = zero;
+    for (size_t k = 0; k < blocks; k++, buffer += 32) {
+      __m256i value = _mm256_loadu_si256((const __m256i *)buffer);
+      acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(value, zero));
+      acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(value, zero));
+      if constexpr (copy) {
+        _mm256_storeu_si256((__m256i *)destination, value);
+        destination += 32;
+      }
+    }
+    size -= blocks * 32;
+
+    uint32_t lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    for (uint32_t lane : lanes)
+      sum = add_carry(sum, lane);
+  }
+  return sum_word64<copy>(buffer, size, sum, destination);
+}
+#endif
+
+bool NetworkUtil::has_sum_kernel(SumKernel kernel) {
+  switch (kernel) {
+  case SumKernel::BYTEWISE:
+  case SumKernel::WORD64:
+    return true;
+#ifdef E_SUM_X86
+  case SumKernel::SSE2:
+    return __builtin_cpu_supports("sse2");
+  case SumKernel::AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+using SumFunction = uint64_t (*)(const uint8_t *, size_t, uint64_t,
+                                 uint8_t *);
+
+template <bool copy> static SumFunction select_sum() {
+#ifdef E_SUM_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return sum_avx2<copy>;
+  if (__builtin_cpu_supports("sse2"))
+    return sum_sse2<copy>;
+#endif
+  return sum_word64<copy>;
+}
+
+// Headers are summed faster without vector setup.
+static constexpr size_t vector_sum_min = 256;
+
 uint16_t NetworkUtil::one_sum(const uint8_t *buffer, size_t size) {
+  static const SumFunction sum = select_sum<false>();
+  if (size < vector_sum_min)
+    return fold_native(sum_word64<false>(buffer, size, 0, nullptr));
+  return fold_native(sum(buffer, size, 0, nullptr));
+}
+
+uint16_t NetworkUtil::copy_and_sum(uint8_t *destination,
+                                   const uint8_t *source, size_t size) {
+  static const SumFunction sum = select_sum<true>();
+  if (size < vector_sum_min)
+    return fold_native(sum_word64<true>(source, size, 0, destination));
+  return fold_native(sum(source, size, 0, destination));
+}
+
+uint16_t NetworkUtil::add_sum(uint16_t sum, uint16_t part, size_t offset) {
+  // A part starting at an odd offset was summed with its bytes swapped.
+  if (offset & 1)
+    part = (uint16_t)((part >> 8) | (part << 8));
+  uint32_t result = (uint32_t)sum + part;
+  result = (result & 0xFFFF) + (result >> 16);
+  return (uint16_t)result;
+}
+
+uint16_t NetworkUtil::one_sum(const uint8_t *buffer, size_t size,
+                              SumKernel kernel) {
+  assert(has_sum_kernel(kernel));
+  switch (kernel) {
+  case SumKernel::WORD64:
+    return fold_native(sum_word64<false>(buffer, size, 0, nullptr));
+#ifdef E_SUM_X86
+  case SumKernel::SSE2:
+    return fold_native(sum_sse2<false>(buffer, size, 0, nullptr));
+  case SumKernel::AVX2:
+    return fold_native(sum_avx2<false>(buffer, size, 0, nullptr));
+#endif
+  default:
+    break;
+  }
+
   bool upper = true;
   uint32_t sum = 0;
   for (size_t k = 0; k < size; k++) {
@@ -65,4 +276,63 @@ uint16_t NetworkUtil::tcp_sum(uint32_t source, uint32_t dest,
   return (uint16_t)sum;
 }
 
+uint16_t NetworkUtil::tcp_sum(uint32_t source, uint32_t dest,
+                              const uint8_t *tcp_header, size_t header_length,
+                              uint16_t payload_sum, size_t payload_length) {
+  if (header_length < 20)
+    return 0;
+  struct pseudoheader pheader;
+  pheader.source = source;
+  pheader.destination = dest;
+  pheader.zero = 0;
+  pheader.protocol = IPPROTO_TCP;
+  pheader.length = htons(header_length + payload_length);
+
+  uint16_t sum = one_sum((uint8_t *)&pheader, sizeof(pheader));
+  sum = add_sum(sum, one_sum(tcp_header, header_length), sizeof(pheader));
+  return add_sum(sum, payload_sum, header_length);
+}
+
+// HC' = ~(~HC + ~m + m') also handles the case where HC is 0xFFFF.
+uint16_t NetworkUtil::update_sum16(uint16_t checksum, uint16_t old_value,
+                                   uint16_t new_value) {
+  uint32_t sum = (uint16_t)~checksum;
+  sum += (uint16_t)~old_value;
+  sum += new_value;
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  return (uint16_t)~sum;
+}
+
+uint16_t NetworkUtil::update_sum32(uint16_t checksum, uint32_t old_value,
+                                   uint32_t new_value) {
+  checksum = update_sum16(checksum, old_value >> 16, new_value >> 16);
+  return update_sum16(checksum, old_value & 0xFFFF, new_value & 0xFFFF);
+}
+
+uint32_t NetworkUtil::flow_hash(const ipv4_t &source, const ipv4_t &dest,
+                                uint8_t protocol, uint16_t source_port,
+                                uint16_t dest_port) {
+  uint64_t key = arrayToUINT64(source) | (arrayToUINT64(dest) << 32);
+  uint64_t rest = ((uint64_t)protocol << 32) | ((uint64_t)source_port << 16) |
+                  dest_port;
+
+  // splitmix64 finalizer over both words
+  uint64_t h = key ^ (rest * 0x9E3779B97F4A7C15ULL);
+  h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+  h ^= h >> 31;
+  return (uint32_t)(h ^ (h >> 32));
+}
+
+uint32_t NetworkUtil::symmetric_flow_hash(const ipv4_t &source,
+                                          const ipv4_t &dest, uint8_t protocol,
+                                          uint16_t source_port,
+                                          uint16_t dest_port) {
+  // Order the endpoints so that swapping them gives the same tuple.
+  if (std::tie(source, source_port) > std::tie(dest, dest_port))
+    return flow_hash(dest, source, protocol, dest_port, source_port);
+  return flow_hash(source, dest, protocol, source_port, dest_port);
+}
+
 } // namespace E
@@ -7,23 +7,64 @@
 
 #include <E/Networking/E_Networking.hpp>
 #include <E/Networking/E_Packet.hpp>
+#include <E/Networking/E_PacketTracker.hpp>
 #include <E/Networking/E_Wire.hpp>
 namespace E {
 
 NetworkModule::NetworkModule(System &system) : Module(system) {}
 
+void NetworkModule::stampIngress(const ModuleID wireID, Packet &packet) {
+  packet.clearContext();
+  PacketMetadata &metadata = packet.getMetadata();
+  auto port = std::find(ports.begin(), ports.end(), wireID);
+  metadata.ingressPort = port != ports.end() ? (int)(port - ports.begin()) : -1;
+  metadata.ingressTime = this->getCurrentTime();
+  PACKET_TRACE(PacketTracker::stamp(packet, PacketTracker::INGRESS, this));
+}
+
 int NetworkModule::connectWire(const ModuleID moduleID) {
   int portID = ports.size();
   ports.push_back(moduleID);
   return portID;
 }
 
+thread_local std::vector<NetworkSystem *> NetworkSystem::installed;
+
 NetworkSystem::NetworkSystem()
-    : System(), NetworkLog(static_cast<System &>(*this)) {
-  this->packetUUIDStart = 0;
+    : System(), NetworkLog(static_cast<System &>(*this)),
+      packetPool(std::make_shared<PacketPool>()) {
+  PACKET_TRACE(packetTracker = std::make_unique<PacketTracker>(*this));
+  installed.push_back(this);
+  install();
 }
 
-NetworkSystem::~NetworkSystem() {}
+NetworkSystem::~NetworkSystem() {
+  if (sampler)
+    sampler->flush();
+  sampler.reset();
+
+  // Packets queued in messages or held by modules are freed here, while
+  // the pool, the statistics and the tracker of this system are installed.
+  destroyModules();
+  PACKET_TRACE(packetTracker->reportLeaks());
+
+  auto self = std::find(installed.begin(), installed.end(), this);
+  if (self != installed.end())
+    installed.erase(self);
+  if (!installed.empty()) {
+    installed.back()->install();
+  } else {
+    PacketPool::install(nullptr);
+    Packet::installStatistics(nullptr);
+    PACKET_TRACE(PacketTracker::install(nullptr));
+  }
+}
+
+void NetworkSystem::install() {
+  PacketPool::install(packetPool.get());
+  Packet::installStatistics(&packetStatistics);
+  PACKET_TRACE(PacketTracker::install(packetTracker.get()));
+}
 
 std::pair<std::shared_ptr<Wire>, std::pair<int, int>>
 NetworkSystem::addWire(NetworkModule &left, NetworkModule &right,
@@ -47,4 +88,27 @@ Size NetworkSystem::getWireSpeed(const ModuleID moduleID) {
   return wire.getWireSpeed();
 }
 
+Sampler &NetworkSystem::getSampler() {
+  if (!sampler)
+    sampler = addModule<Sampler>(*this);
+  return *sampler;
+}
+
+Sampler::ProbeID NetworkSystem::addProbe(std::string name, Time interval,
+                                         Sampler::Probe probe) {
+  return getSampler().addProbe(std::move(name), interval, std::move(probe));
+}
+
+PacketPool::Statistics NetworkSystem::getPacketPoolStatistics() {
+  return packetPool->getStatistics();
+}
+
+Packet::Statistics NetworkSystem::getPacketStatistics() {
+  return packetStatistics;
+}
+
+#ifdef ENABLE_PACKET_TRACE
+PacketTracker *NetworkSystem::getPacketTracker() { return packetTracker.get(); }
+#endif
+
 } // namespace E
@@ -6,93 +6,529 @@
  */
 
 #include <E/E_Common.hpp>
+#include <E/Networking/E_NetworkUtil.hpp>
 #include <E/Networking/E_Packet.hpp>
+#include <E/Networking/E_PacketTracker.hpp>
 
 namespace E {
 
-std::unordered_set<UUID> Packet::packetUUIDSet;
-UUID Packet::packetUUIDStart = 0;
+// UUIDs are never reused; 2^64 packets will not wrap in practice.
+std::atomic<UUID> Packet::packetUUIDNext{0};
 UUID Packet::allocatePacketUUID() {
-  UUID candidate = packetUUIDStart;
-  do {
-    if (packetUUIDSet.find(candidate) == packetUUIDSet.end()) {
-      packetUUIDStart = candidate + 1;
-      packetUUIDSet.insert(candidate);
-      return candidate;
-    }
-    candidate++;
-  } while (candidate != packetUUIDStart);
-  assert(0);
-  return 0;
+  return packetUUIDNext.fetch_add(1, std::memory_order_relaxed);
 }
-void Packet::freePacketUUID(UUID uuid) { packetUUIDSet.erase(uuid); }
 
-Packet::Packet(UUID uuid, size_t size) : buffer(size), packetID(uuid) {
+static constexpr size_t no_offset = std::numeric_limits<size_t>::max();
+#ifdef ENABLE_PACKET_TRACE
+// UUID of a moved-from Packet, so that it is not released twice.
+static constexpr UUID moved_uuid = std::numeric_limits<UUID>::max();
+#endif
+
+class Packet::Segment {
+public:
+  PacketBuffer buffer;
+  size_t offset;
+  size_t length;
+};
+
+class Packet::Context {
+public:
+  std::array<size_t, LAYER_COUNT> layerOffset;
+  PacketMetadata metadata;
+  std::vector<Segment> segments;
+  size_t segmentLength = 0;
+
+  Context() { layerOffset.fill(no_offset); }
+
+  static Context *allocate();
+  static Context *copy(const Context *other);
+  static void release(Context *context);
+
+private:
+  // Released Contexts are reused by the Packets of the same thread.
+  static thread_local std::vector<std::unique_ptr<Context>> freeList;
+  static constexpr size_t FREE_LIST_SIZE = 1024;
+};
+
+thread_local std::vector<std::unique_ptr<Packet::Context>>
+    Packet::Context::freeList;
+
+Packet::Context *Packet::Context::allocate() {
+  if (freeList.empty())
+    return new Context();
+  Context *context = freeList.back().release();
+  freeList.pop_back();
+  return context;
+}
+
+Packet::Context *Packet::Context::copy(const Context *other) {
+  if (other == nullptr)
+    return nullptr;
+  Context *context = allocate();
+  *context = *other;
+  return context;
+}
 
-  std::fill(this->buffer.begin(), this->buffer.end(), 0);
+void Packet::Context::release(Context *context) {
+  if (context == nullptr)
+    return;
+  if (freeList.size() >= FREE_LIST_SIZE) {
+    delete context;
+    return;
+  }
+  context->layerOffset.fill(no_offset);
+  context->metadata = PacketMetadata();
+  context->segments.clear();
+  context->segmentLength = 0;
+  freeList.emplace_back(context);
 }
 
-Packet::Packet(const Packet &other)
-    : buffer(other.buffer), packetID(other.packetID) {}
+Packet::Packet(UUID uuid, size_t size, size_t headroom, bool zero)
+    : buffer(PacketBuffer::allocate(headroom + size, zero)), head(headroom),
+      length(size), context(nullptr), packetID(uuid) {
+  assert(headroom + size <= std::numeric_limits<uint32_t>::max());
+}
+
+Packet::Context &Packet::getContext() {
+  if (context == nullptr)
+    context = Context::allocate();
+  return *context;
+}
+
+thread_local Packet::Statistics *Packet::statistics = nullptr;
+
+Packet::Statistics *Packet::installStatistics(Statistics *statistics) {
+  Statistics *previous = Packet::statistics;
+  Packet::statistics = statistics;
+  return previous;
+}
+
+void Packet::countCopiedBytes(size_t bytes) {
+  if (statistics)
+    statistics->copiedBytes += bytes;
+}
+
+Packet::Packet(const Packet &other, UUID uuid)
+    : buffer(other.buffer), head(other.head), length(other.length),
+      context(Context::copy(other.context)), packetID(uuid) {}
+
+Packet::Packet(const Packet &other) : Packet(other, other.packetID) {
+  if (statistics)
+    statistics->copies++;
+  PACKET_TRACE(PacketTracker::referenced(packetID));
+}
 
 Packet::Packet(Packet &&other) noexcept
-    : buffer(std::move(other.buffer)), packetID(other.packetID) {
-  other.buffer.clear();
+    : buffer(std::move(other.buffer)), head(other.head), length(other.length),
+      context(other.context), packetID(other.packetID) {
+  PACKET_TRACE(other.packetID = moved_uuid);
+  other.head = 0;
+  other.length = 0;
+  other.context = nullptr;
 }
 
 Packet &Packet::operator=(const Packet &other) {
+  if (statistics)
+    statistics->copies++;
+  PACKET_TRACE(PacketTracker::referenced(other.packetID));
+  PACKET_TRACE(PacketTracker::released(packetID));
+  Context *copied = Context::copy(other.context);
+  Context::release(context);
   buffer = other.buffer;
+  head = other.head;
+  length = other.length;
+  context = copied;
   packetID = other.packetID;
   return *this;
 }
 
 Packet &Packet::operator=(Packet &&other) noexcept {
+  if (this == &other)
+    return *this;
+  PACKET_TRACE(PacketTracker::released(packetID));
+  Context::release(context);
   buffer = std::move(other.buffer);
+  head = other.head;
+  length = other.length;
+  context = other.context;
   packetID = std::move(other.packetID);
+  PACKET_TRACE(other.packetID = moved_uuid);
+  other.head = 0;
+  other.length = 0;
+  other.context = nullptr;
   return *this;
 }
 
-Packet::Packet(size_t size) : Packet(allocatePacketUUID(), size) {}
+Packet::Packet(size_t size) : Packet(allocatePacketUUID(), size, 0, true) {
+  PACKET_TRACE(PacketTracker::allocated(packetID, __builtin_return_address(0)));
+}
+
+Packet::Packet(size_t size, size_t headroom, bool zero)
+    : Packet(allocatePacketUUID(), size, headroom, zero) {
+  PACKET_TRACE(PacketTracker::allocated(packetID, __builtin_return_address(0)));
+}
 
-Packet::~Packet() { freePacketUUID(this->packetID); }
+Packet::~Packet() {
+  PACKET_TRACE(PacketTracker::released(packetID));
+  Context::release(context);
+}
 
 Packet Packet::clone() const {
-
-  Packet pkt(this->buffer.size());
-  pkt.buffer = this->buffer;
+  if (statistics)
+    statistics->clones++;
+  Packet pkt(*this, allocatePacketUUID());
+  PACKET_TRACE(PacketTracker::cloned(packetID, pkt.packetID,
+                                     __builtin_return_address(0)));
   return pkt;
 }
 
+void Packet::unshare() {
+  if (!buffer) {
+    buffer = PacketBuffer::allocate(0, false);
+  } else if (buffer.shared()) {
+    auto copied = PacketBuffer::allocate(head + length, false);
+    memcpy(copied.data(), buffer.data(), head + length);
+    countCopiedBytes(head + length);
+    buffer = std::move(copied);
+  }
+}
+
+void Packet::unshare(Segment &segment) {
+  if (segment.buffer.shared()) {
+    auto copied = PacketBuffer::allocate(segment.length, false);
+    memcpy(copied.data(), segment.buffer.data() + segment.offset,
+           segment.length);
+    countCopiedBytes(segment.length);
+    segment.buffer = std::move(copied);
+    segment.offset = 0;
+  }
+}
+
+void Packet::grow(size_t headroom, size_t tailroom) {
+  auto grown = PacketBuffer::allocate(headroom + length + tailroom, false);
+  if (length > 0)
+    memcpy(grown.data() + headroom, buffer.data() + head, length);
+  countCopiedBytes(length);
+
+  if (context) {
+    for (size_t &offset : context->layerOffset) {
+      if (offset != no_offset)
+        offset = offset + headroom - head;
+    }
+  }
+  buffer = std::move(grown);
+  head = headroom;
+}
+
+static void copy_part(char *destination, const char *source, size_t length,
+                      size_t offset, uint16_t *sum) {
+  if (sum == nullptr) {
+    memcpy(destination, source, length);
+    return;
+  }
+  uint16_t part = NetworkUtil::copy_and_sum((uint8_t *)destination,
+                                            (const uint8_t *)source, length);
+  *sum = NetworkUtil::add_sum(*sum, part, offset);
+}
+
 size_t Packet::writeData(size_t offset, const void *data, size_t length) {
-  size_t actual_offset = std::min(offset, buffer.size());
-  size_t actual_write = std::min(length, buffer.size() - actual_offset);
+  return write(offset, data, length, nullptr);
+}
+
+size_t Packet::writeDataAndSum(size_t offset, const void *data,
+                               size_t length, uint16_t &sum) {
+  return write(offset, data, length, &sum);
+}
+
+size_t Packet::write(size_t offset, const void *data, size_t length,
+                     uint16_t *sum) {
+  size_t size = getSize();
+  size_t actual_offset = std::min(offset, size);
+  size_t actual_write = std::min(length, size - actual_offset);
 
   if (actual_write == 0)
     return 0;
 
   assert(data);
-  memcpy(this->buffer.data() + actual_offset, data, length);
+  const char *source = static_cast<const char *>(data);
+  size_t position = actual_offset;
+  size_t remaining = actual_write;
+  if (actual_offset < this->length) {
+    size_t part = std::min<size_t>(remaining, this->length - actual_offset);
+    unshare();
+    copy_part(this->buffer.data() + head + actual_offset, source, part,
+              position, sum);
+    source += part;
+    position += part;
+    remaining -= part;
+    actual_offset = 0;
+  } else {
+    actual_offset -= this->length;
+  }
+
+  if (context == nullptr)
+    return actual_write;
+  for (Segment &segment : context->segments) {
+    if (remaining == 0)
+      break;
+    if (actual_offset >= segment.length) {
+      actual_offset -= segment.length;
+      continue;
+    }
+    size_t part = std::min(remaining, segment.length - actual_offset);
+    unshare(segment);
+    copy_part(segment.buffer.data() + segment.offset + actual_offset, source,
+              part, position, sum);
+    source += part;
+    position += part;
+    remaining -= part;
+    actual_offset = 0;
+  }
   return actual_write;
 }
 size_t Packet::readData(size_t offset, void *data, size_t length) const {
-  size_t actual_offset = std::min(offset, buffer.size());
-  size_t actual_read = std::min(length, buffer.size() - actual_offset);
+  if (offset <= this->length && length <= this->length - offset) {
+    if (length == 0)
+      return 0;
+    assert(data);
+    memcpy(data, buffer.data() + head + offset, length);
+    return length;
+  }
 
-  if (actual_read == 0)
-    return 0;
+  char *destination = static_cast<char *>(data);
+  return visitData(offset, length, [&](const char *piece, size_t part) {
+    memcpy(destination, piece, part);
+    destination += part;
+  });
+}
+const uint8_t *Packet::peek(size_t offset, size_t length) const {
+  if (!buffer || offset > this->length || length > this->length - offset)
+    return nullptr;
+  return reinterpret_cast<const uint8_t *>(buffer.data() + head + offset);
+}
+uint8_t *Packet::map(size_t offset, size_t length) {
+  if (offset > this->length || length > this->length - offset)
+    return nullptr;
+  unshare();
+  return reinterpret_cast<uint8_t *>(buffer.data() + head + offset);
+}
+bool Packet::updateField16(size_t offset, uint16_t value,
+                           size_t checksumOffset) {
+  if (!peek(offset, 2) || !peek(checksumOffset, 2))
+    return false;
+  uint8_t *field = map(offset, 2);
+  uint8_t *checksum = map(checksumOffset, 2);
+  uint16_t old_value = (uint16_t)((field[0] << 8) | field[1]);
+  uint16_t sum = (uint16_t)((checksum[0] << 8) | checksum[1]);
+  sum = NetworkUtil::update_sum16(sum, old_value, value);
+  field[0] = value >> 8;
+  field[1] = value & 0xFF;
+  checksum[0] = sum >> 8;
+  checksum[1] = sum & 0xFF;
+  return true;
+}
+bool Packet::updateField32(size_t offset, uint32_t value,
+                           size_t checksumOffset) {
+  if (!peek(offset, 4) || !peek(checksumOffset, 2))
+    return false;
+  uint8_t *field = map(offset, 4);
+  uint8_t *checksum = map(checksumOffset, 2);
+  uint32_t old_value = ((uint32_t)field[0] << 24) |
+                       ((uint32_t)field[1] << 16) |
+                       ((uint32_t)field[2] << 8) | (uint32_t)field[3];
+  uint16_t sum = (uint16_t)((checksum[0] << 8) | checksum[1]);
+  sum = NetworkUtil::update_sum32(sum, old_value, value);
+  field[0] = value >> 24;
+  field[1] = (value >> 16) & 0xFF;
+  field[2] = (value >> 8) & 0xFF;
+  field[3] = value & 0xFF;
+  checksum[0] = sum >> 8;
+  checksum[1] = sum & 0xFF;
+  return true;
+}
+size_t Packet::visitData(
+    size_t offset, size_t length,
+    const std::function<void(const char *, size_t)> &visitor) const {
+  size_t size = getSize();
+  size_t actual_offset = std::min(offset, size);
+  size_t actual_visit = std::min(length, size - actual_offset);
 
-  assert(data);
-  memcpy(data, buffer.data() + actual_offset, length);
-  return actual_read;
+  size_t remaining = actual_visit;
+  if (remaining > 0 && actual_offset < this->length) {
+    size_t part = std::min<size_t>(remaining, this->length - actual_offset);
+    visitor(buffer.data() + head + actual_offset, part);
+    remaining -= part;
+    actual_offset = 0;
+  } else {
+    actual_offset -= std::min<size_t>(actual_offset, this->length);
+  }
+
+  if (context == nullptr)
+    return actual_visit;
+  for (const Segment &segment : context->segments) {
+    if (remaining == 0)
+      break;
+    if (actual_offset >= segment.length) {
+      actual_offset -= segment.length;
+      continue;
+    }
+    size_t part = std::min(remaining, segment.length - actual_offset);
+    visitor(segment.buffer.data() + segment.offset + actual_offset, part);
+    remaining -= part;
+    actual_offset = 0;
+  }
+  return actual_visit;
+}
+size_t Packet::appendPayload(const PacketBuffer &buffer, size_t offset,
+                             size_t length) {
+  assert(offset <= buffer.size() && length <= buffer.size() - offset);
+  if (length > 0) {
+    Context &context = getContext();
+    context.segments.push_back({buffer, offset, length});
+    context.segmentLength += length;
+  }
+  return getSize();
 }
+size_t Packet::getSegmentCount() const {
+  return context ? context->segments.size() : 0;
+}
+
+void Packet::linearize() {
+  if (context == nullptr || context->segments.empty())
+    return;
+
+  size_t size = getSize();
+  assert(head + size <= std::numeric_limits<uint32_t>::max());
+  auto flat = PacketBuffer::allocate(head + size, false);
+  if (head + length > 0)
+    memcpy(flat.data(), buffer.data(), head + length);
+  size_t position = head + length;
+  for (const Segment &segment : context->segments) {
+    memcpy(flat.data() + position, segment.buffer.data() + segment.offset,
+           segment.length);
+    position += segment.length;
+  }
+
+  countCopiedBytes(head + size);
+  buffer = std::move(flat);
+  length = size;
+  context->segments.clear();
+  context->segmentLength = 0;
+}
+
 size_t Packet::setSize(size_t size) {
-  buffer.resize(size);
-  return buffer.size();
+  assert(head + size <= std::numeric_limits<uint32_t>::max());
+  if (size <= getSize()) {
+    if (context && size > length) {
+      std::vector<Segment> &segments = context->segments;
+      size_t keep = size - length;
+      size_t count = 0;
+      for (; keep > segments[count].length; count++)
+        keep -= segments[count].length;
+      segments[count].length = keep;
+      segments.resize(count + 1);
+      context->segmentLength = size - length;
+      return getSize();
+    }
+    if (context) {
+      context->segments.clear();
+      context->segmentLength = 0;
+    }
+  } else {
+    linearize();
+  }
+
+  if (size > length + getTailroom())
+    grow(head, size - length);
+  else
+    unshare();
+
+  if (size > length)
+    memset(buffer.data() + head + length, 0, size - length);
+  length = size;
+  return length;
+}
+size_t Packet::getSize() const {
+  return length + (context ? context->segmentLength : 0);
+}
+
+void Packet::reserve(size_t n) {
+  if (getHeadroom() < n)
+    grow(n, getTailroom());
+}
+
+size_t Packet::push(size_t n) {
+  assert(getSize() + n <= std::numeric_limits<uint32_t>::max());
+  reserve(n);
+  head -= n;
+  length += n;
+  return length;
+}
+
+size_t Packet::pull(size_t n) {
+  size_t actual_pull = std::min(n, getSize());
+  size_t linear_pull = std::min<size_t>(actual_pull, length);
+  head += linear_pull;
+  length -= linear_pull;
+
+  size_t segment_pull = actual_pull - linear_pull;
+  if (segment_pull == 0)
+    return actual_pull;
+  std::vector<Segment> &segments = context->segments;
+  size_t remaining = segment_pull;
+  size_t count = 0;
+  while (remaining > 0 && remaining >= segments[count].length) {
+    remaining -= segments[count].length;
+    count++;
+  }
+  if (remaining > 0) {
+    segments[count].offset += remaining;
+    segments[count].length -= remaining;
+  }
+  segments.erase(segments.begin(), segments.begin() + count);
+  context->segmentLength -= segment_pull;
+  return actual_pull;
+}
+
+size_t Packet::getHeadroom() const { return head; }
+
+size_t Packet::getTailroom() const {
+  if (context && !context->segments.empty())
+    return 0;
+  return buffer.size() - head - length;
+}
+
+void Packet::setLayerOffset(Layer layer, size_t offset) {
+  assert(layer < LAYER_COUNT);
+  getContext().layerOffset[layer] = head + offset;
+}
+
+std::optional<size_t> Packet::getLayerOffset(Layer layer) const {
+  assert(layer < LAYER_COUNT);
+  if (context == nullptr)
+    return {};
+  size_t mark = context->layerOffset[layer];
+  if (mark == no_offset || mark < head)
+    return {};
+  return mark - head;
 }
-size_t Packet::getSize() const { return buffer.size(); }
 
 UUID Packet::getUUID() const { return this->packetID; }
 
-void Packet::clearContext() {}
+PacketMetadata &Packet::getMetadata() { return getContext().metadata; }
+
+const PacketMetadata &Packet::getMetadata() const {
+  static const PacketMetadata none;
+  return context ? context->metadata : none;
+}
+
+void Packet::clearContext() {
+  if (context == nullptr)
+    return;
+  context->layerOffset.fill(no_offset);
+  uint8_t offload = context->metadata.offload;
+  context->metadata = PacketMetadata();
+  context->metadata.offload = offload;
+}
 
 } // namespace E
@@ -0,0 +1,128 @@
+/*
+ * E_PacketPool.cpp
+ */
+
+#include <E/Networking/E_PacketPool.hpp>
+
+namespace E {
+
+PacketBuffer::PacketBuffer(const PacketBuffer &other) : chunk(other.chunk) {
+  if (chunk)
+    chunk->refcount++;
+}
+
+PacketBuffer::PacketBuffer(PacketBuffer &&other) noexcept
+    : chunk(other.chunk) {
+  other.chunk = nullptr;
+}
+
+PacketBuffer &PacketBuffer::operator=(const PacketBuffer &other) {
+  if (this != &other) {
+    release();
+    chunk = other.chunk;
+    if (chunk)
+      chunk->refcount++;
+  }
+  return *this;
+}
+
+PacketBuffer &PacketBuffer::operator=(PacketBuffer &&other) noexcept {
+  if (this != &other) {
+    release();
+    chunk = other.chunk;
+    other.chunk = nullptr;
+  }
+  return *this;
+}
+
+PacketBuffer::~PacketBuffer() { release(); }
+
+void PacketBuffer::release() {
+  if (chunk == nullptr)
+    return;
+  if (--chunk->refcount == 0) {
+    if (chunk->pool) {
+      auto pool = std::move(chunk->pool);
+      pool->recycle(chunk);
+    } else {
+      chunk->~Chunk();
+      ::operator delete(chunk);
+    }
+  }
+  chunk = nullptr;
+}
+
+PacketBuffer PacketBuffer::allocate(size_t size, bool zero) {
+  Chunk *chunk;
+  if (PacketPool::current)
+    chunk = PacketPool::current->allocate(size);
+  else
+    chunk = newChunk(size);
+
+  chunk->refcount = 1;
+  if (zero)
+    memset(chunk->data(), 0, size);
+  return PacketBuffer(chunk);
+}
+
+PacketBuffer::Chunk *PacketBuffer::newChunk(size_t capacity) {
+  void *memory = ::operator new(sizeof(Chunk) + capacity);
+  auto chunk = new (memory) Chunk();
+  chunk->refcount = 0;
+  chunk->capacity = capacity;
+  return chunk;
+}
+
+thread_local PacketPool *PacketPool::current = nullptr;
+
+PacketPool::PacketPool() {}
+
+PacketPool::~PacketPool() {
+  for (auto &chunks : freeList) {
+    for (auto chunk : chunks) {
+      chunk->~Chunk();
+      ::operator delete(chunk);
+    }
+  }
+  if (current == this)
+    current = nullptr;
+}
+
+PacketPool *PacketPool::install(PacketPool *pool) {
+  PacketPool *previous = current;
+  current = pool;
+  return previous;
+}
+
+PacketPool::Statistics PacketPool::getStatistics() const { return stats; }
+
+PacketBuffer::Chunk *PacketPool::allocate(size_t size) {
+  PacketBuffer::Chunk *chunk;
+  if (size > MTU_SIZE) {
+    stats.oversized++;
+    chunk = PacketBuffer::newChunk(size);
+  } else {
+    SizeClass sizeClass = size > SMALL_SIZE ? MTU : SMALL;
+    auto &chunks = freeList[sizeClass];
+    if (!chunks.empty()) {
+      stats.hits++;
+      stats.cached--;
+      chunk = chunks.back();
+      chunks.pop_back();
+    } else {
+      stats.misses++;
+      chunk =
+          PacketBuffer::newChunk(sizeClass == MTU ? MTU_SIZE : SMALL_SIZE);
+    }
+    chunk->pool = shared_from_this();
+  }
+  return chunk;
+}
+
+void PacketPool::recycle(PacketBuffer::Chunk *chunk) {
+  SizeClass sizeClass = chunk->capacity > SMALL_SIZE ? MTU : SMALL;
+  freeList[sizeClass].push_back(chunk);
+  stats.cached++;
+}
+
+} // namespace E
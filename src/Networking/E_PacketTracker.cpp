@@ -0,0 +1,232 @@
+/*
+ * E_PacketTracker.cpp
+ */
+
+#include <E/Networking/E_PacketTracker.hpp>
+
+#ifdef ENABLE_PACKET_TRACE
+#include <E/Networking/E_Networking.hpp>
+#include <E/Networking/E_Packet.hpp>
+#include <dlfcn.h>
+#ifdef HAVE_DEMANGLE
+#include <cxxabi.h>
+#endif
+
+namespace E {
+
+thread_local PacketTracker *PacketTracker::current = nullptr;
+
+PacketTracker::PacketTracker(NetworkSystem &system)
+    : NetworkLog(static_cast<System &>(system)), system(system), alive(0) {}
+
+PacketTracker::~PacketTracker() {
+  if (current == this)
+    current = nullptr;
+}
+
+PacketTracker *PacketTracker::install(PacketTracker *tracker) {
+  PacketTracker *previous = current;
+  current = tracker;
+  return previous;
+}
+
+void PacketTracker::allocated(UUID uuid, const void *site) {
+  if (current == nullptr)
+    return;
+  Record &record = current->records[uuid];
+  record.site = site;
+  record.references = 1;
+  record.hops.push_back(
+      {ALLOCATED, current->system.getCurrentTime(), 0});
+  current->alive++;
+  current->print_log(PACKET_ALLOC, "Packet [%" PRIu64 "] allocated at %s",
+                     uuid, current->describeSite(site).c_str());
+}
+
+void PacketTracker::cloned(UUID parent, UUID child, const void *site) {
+  if (current == nullptr)
+    return;
+  Time now = current->system.getCurrentTime();
+  auto parentIter = current->records.find(parent);
+  if (parentIter != current->records.end())
+    parentIter->second.clones++;
+  Record &record = current->records[child];
+  record.parent = parent;
+  record.cloneTime = now;
+  record.site = site;
+  record.references = 1;
+  record.hops.push_back({CLONED, now, 0});
+  current->alive++;
+  current->print_log(PACKET_CLONE,
+                     "Packet [%" PRIu64 "] cloned from [%" PRIu64 "] at %s",
+                     child, parent, current->describeSite(site).c_str());
+}
+
+void PacketTracker::referenced(UUID uuid) {
+  if (current == nullptr)
+    return;
+  auto iter = current->records.find(uuid);
+  if (iter != current->records.end() && iter->second.references > 0)
+    iter->second.references++;
+}
+
+void PacketTracker::released(UUID uuid) {
+  if (current == nullptr)
+    return;
+  auto iter = current->records.find(uuid);
+  if (iter == current->records.end() || iter->second.references == 0)
+    return;
+
+  Record &record = iter->second;
+  if (--record.references == 0) {
+    Time now = current->system.getCurrentTime();
+    record.hops.push_back({FREED, now, 0});
+    current->alive--;
+    current->print_log(PACKET_FREE,
+                       "Packet [%" PRIu64 "] freed after [%" PRIu64 "] hops",
+                       uuid, (uint64_t)record.hops.size() - 2);
+    current->erase(uuid);
+  }
+}
+
+void PacketTracker::erase(UUID uuid) {
+  while (true) {
+    // Kept clones still need this record for their latency.
+    auto iter = records.find(uuid);
+    if (iter == records.end() || iter->second.references > 0 ||
+        iter->second.clones > 0)
+      return;
+    std::optional<UUID> parent = iter->second.parent;
+    records.erase(iter);
+    if (!parent.has_value())
+      return;
+    auto parentIter = records.find(parent.value());
+    if (parentIter == records.end())
+      return;
+    parentIter->second.clones--;
+    uuid = parent.value();
+  }
+}
+
+void PacketTracker::stamp(const Packet &packet, Stage stage, Module *module,
+                          std::optional<Time> time) {
+  if (current == nullptr)
+    return;
+  auto iter = current->records.find(packet.getUUID());
+  if (iter == current->records.end())
+    return;
+  ModuleID moduleID =
+      module != nullptr ? current->system.lookupModuleID(*module) : 0;
+  if (moduleID != 0 &&
+      current->moduleNames.find(moduleID) == current->moduleNames.end())
+    current->moduleNames.emplace(moduleID, module->getModuleName());
+  iter->second.hops.push_back(
+      {stage, time.value_or(current->system.getCurrentTime()), moduleID});
+}
+
+const PacketTracker::Record *PacketTracker::getRecord(UUID uuid) const {
+  auto iter = records.find(uuid);
+  return iter == records.end() ? nullptr : &iter->second;
+}
+
+void PacketTracker::collectHops(UUID uuid, Time until,
+                                std::vector<Hop> &hops) const {
+  auto iter = records.find(uuid);
+  if (iter == records.end())
+    return;
+  const Record &record = iter->second;
+  if (record.parent.has_value())
+    collectHops(record.parent.value(), record.cloneTime, hops);
+  for (const Hop &hop : record.hops) {
+    if (hop.time > until || hop.stage == FREED)
+      break;
+    hops.push_back(hop);
+  }
+}
+
+PacketTracker::Latency PacketTracker::getLatency(UUID uuid) const {
+  std::vector<Hop> hops;
+  auto iter = records.find(uuid);
+  if (iter == records.end())
+    return {};
+
+  // Ancestors contribute their history up to the clone point.
+  if (iter->second.parent.has_value())
+    collectHops(iter->second.parent.value(), iter->second.cloneTime, hops);
+  hops.insert(hops.end(), iter->second.hops.begin(), iter->second.hops.end());
+
+  Latency latency;
+  for (size_t k = 0; k + 1 < hops.size(); k++) {
+    if (hops[k].stage == FREED)
+      continue;
+    Time span = hops[k + 1].time - hops[k].time;
+    switch (hops[k].stage) {
+    case LINK_ENQUEUE:
+      latency.queueing += span;
+      break;
+    case LINK_DEQUEUE:
+    case WIRE_TRANSMIT:
+      latency.serialization += span;
+      break;
+    case WIRE_TRANSMITTED:
+      latency.propagation += span;
+      break;
+    default:
+      latency.processing += span;
+      break;
+    }
+  }
+  return latency;
+}
+
+std::vector<UUID> PacketTracker::getAlivePackets() const {
+  std::vector<UUID> result;
+  for (const auto &[uuid, record] : records) {
+    if (record.references > 0)
+      result.push_back(uuid);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+size_t PacketTracker::reportLeaks() {
+  if (alive == 0)
+    return 0;
+
+  auto leaked = getAlivePackets();
+  for (UUID uuid : leaked) {
+    const Record &record = records.at(uuid);
+    const Hop &last = record.hops.back();
+    auto name = moduleNames.find(last.module);
+    print_log(MODULE_ERROR,
+              "Packet [%" PRIu64 "] is still alive (allocated at %s, "
+              "last seen at [%" PRIu64 "] in [%s])",
+              uuid, describeSite(record.site).c_str(), last.time,
+              name != moduleNames.end() ? name->second.c_str() : "-");
+  }
+  return leaked.size();
+}
+
+std::string PacketTracker::describeSite(const void *site) const {
+  Dl_info info;
+  if (site == nullptr || dladdr(site, &info) == 0 ||
+      info.dli_sname == nullptr) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%p", site);
+    return buffer;
+  }
+
+#ifdef HAVE_DEMANGLE
+  auto ptr = std::unique_ptr<char, decltype(&std::free)>{
+      abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, nullptr),
+      std::free};
+  const char *name = ptr ? ptr.get() : info.dli_sname;
+#else
+  const char *name = info.dli_sname;
+#endif
+  return std::string(name) + "+" +
+         std::to_string((const char *)site - (const char *)info.dli_saddr);
+}
+
+} // namespace E
+#endif /* ENABLE_PACKET_TRACE */
@@ -0,0 +1,168 @@
+/*
+ * E_Sampler.cpp
+ */
+
+#include <E/Networking/E_Networking.hpp>
+#include <E/Networking/E_Sampler.hpp>
+#include <fstream>
+
+namespace E {
+
+Sampler::Sampler(NetworkSystem &system)
+    : Module(system), NetworkLog(static_cast<System &>(system)),
+      networkSystem(system), scheduledTime(0) {}
+
+Sampler::~Sampler() {}
+
+Sampler::ProbeID Sampler::addProbe(std::string name, Time interval,
+                                   Probe probe) {
+  assert(interval > 0);
+  Column column;
+  column.name = std::move(name);
+  column.interval = interval;
+  column.nextSample = getCurrentTime() + interval;
+  column.probe = std::move(probe);
+  column.values.assign(ticks.size(), std::nan(""));
+  columns.push_back(std::move(column));
+
+  schedule();
+  return columns.size() - 1;
+}
+
+void Sampler::schedule() {
+  if (columns.empty())
+    return;
+
+  Time next = columns.front().nextSample;
+  for (const Column &column : columns)
+    next = std::min(next, column.nextSample);
+
+  if (scheduled.has_value()) {
+    if (scheduledTime <= next)
+      return;
+    cancelMessage(scheduled.value());
+  }
+
+  Time now = getCurrentTime();
+  scheduledTime = next;
+  scheduled = sendMessageSelf(std::make_unique<Tick>(),
+                              next > now ? next - now : 0);
+}
+
+Module::Message Sampler::messageReceived(const ModuleID from,
+                                         Module::MessageBase &message) {
+  (void)from;
+  assert(typeid(message) == typeid(Tick &));
+  (void)message;
+  scheduled.reset();
+
+  Time now = getCurrentTime();
+  ticks.push_back(now);
+  for (Column &column : columns) {
+    if (column.nextSample <= now) {
+      column.values.push_back(column.probe());
+      while (column.nextSample <= now)
+        column.nextSample += column.interval;
+    } else {
+      column.values.push_back(std::nan(""));
+    }
+  }
+
+  // This tick is still counted as pending.
+  if (networkSystem.getPendingMessageCount() > 1)
+    schedule();
+
+  return nullptr;
+}
+
+void Sampler::messageFinished(const ModuleID to, Module::Message message,
+                              Module::MessageBase &response) {
+  (void)to;
+  (void)message;
+  assert(dynamic_cast<Module::EmptyMessage &>(response) ==
+         Module::EmptyMessage::shared());
+}
+
+void Sampler::messageCancelled(const ModuleID to, Module::Message message) {
+  (void)to;
+  (void)message;
+}
+
+void Sampler::setOutput(const std::string &filename, Format format) {
+  output = {filename, format};
+}
+
+void Sampler::flush() {
+  if (!output.has_value())
+    return;
+  if (output->second == Format::CSV)
+    writeCSV(output->first);
+  else
+    writeBinary(output->first);
+}
+
+void Sampler::writeCSV(const std::string &filename) {
+  FILE *fp = fopen(filename.c_str(), "w");
+  if (fp == nullptr) {
+    print_log(MODULE_ERROR, "Cannot open sampler output [%s]",
+              filename.c_str());
+    return;
+  }
+
+  fprintf(fp, "time");
+  for (const Column &column : columns)
+    fprintf(fp, ",%s", column.name.c_str());
+  fprintf(fp, "\n");
+
+  for (size_t row = 0; row < ticks.size(); row++) {
+    fprintf(fp, "%" PRIu64, ticks[row]);
+    for (const Column &column : columns) {
+      if (std::isnan(column.values[row]))
+        fprintf(fp, ",");
+      else
+        fprintf(fp, ",%.17g", column.values[row]);
+    }
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+}
+
+void Sampler::writeBinary(const std::string &filename) {
+  std::ofstream file(filename, std::ofstream::binary);
+  if (!file.is_open()) {
+    print_log(MODULE_ERROR, "Cannot open sampler output [%s]",
+              filename.c_str());
+    return;
+  }
+
+  const uint32_t magic = 0x504D5345; // "ESMP"
+  const uint32_t version = 1;
+  const uint64_t probe_count = columns.size();
+  const uint64_t tick_count = ticks.size();
+  file.write((const char *)&magic, sizeof(magic));
+  file.write((const char *)&version, sizeof(version));
+  file.write((const char *)&probe_count, sizeof(probe_count));
+  file.write((const char *)&tick_count, sizeof(tick_count));
+
+  for (const Column &column : columns) {
+    uint32_t length = column.name.size();
+    file.write((const char *)&length, sizeof(length));
+    file.write(column.name.data(), length);
+  }
+
+  static_assert(sizeof(Time) == sizeof(uint64_t));
+  static_assert(sizeof(Real) == sizeof(double));
+  file.write((const char *)ticks.data(), ticks.size() * sizeof(Time));
+  for (const Column &column : columns)
+    file.write((const char *)column.values.data(),
+               column.values.size() * sizeof(Real));
+}
+
+const std::vector<Time> &Sampler::getTickTimes() const { return ticks; }
+
+const std::vector<Real> &Sampler::getSamples(ProbeID probeID) const {
+  assert(probeID < columns.size());
+  return columns[probeID].values;
+}
+
+} // namespace E
@@ -5,6 +5,7 @@
  *      Author: leeopop
  */
 
+#include <E/Networking/E_HeaderView.hpp>
 #include <E/Networking/E_NetworkUtil.hpp>
 #include <E/Networking/E_Packet.hpp>
 #include <E/Networking/E_Switch.hpp>
@@ -12,6 +13,8 @@
 
 namespace E {
 
+static constexpr mac_t mac_broadcast = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
 Switch::Switch(std::string name, NetworkSystem &system, bool unreliable)
     : Link(name, system) {
   this->unreliable = unreliable;
@@ -23,62 +26,42 @@ Switch::Switch(std::string name, NetworkSystem &system, bool unreliable)
 
 void Switch::addMACEntry(int port, const mac_t &mac) {
   uint64_t mac_int = NetworkUtil::arrayToUINT64(mac);
-  auto wireID = ports[port];
-  if (this->mac_table.find(wireID) == this->mac_table.end())
-    this->mac_table[wireID] = std::unordered_set<uint64_t>();
-  this->mac_table[wireID].insert(mac_int);
+  auto &entry = this->mac_table[mac_int];
+  auto iter = std::lower_bound(entry.begin(), entry.end(), port);
+  if (iter == entry.end() || *iter != port)
+    entry.insert(iter, port);
 }
 
-void Switch::packetArrived(const ModuleID inWireID, Packet &&packet) {
-  mac_t mac;
-  mac_t broadcast = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+const std::vector<int> *Switch::lookup(const Packet &packet) const {
+  const mac_t &mac = packet.getMetadata().destinationMAC;
+  if (mac == mac_broadcast)
+    return nullptr;
+
+  auto iter = this->mac_table.find(NetworkUtil::arrayToUINT64(mac));
+  if (iter == this->mac_table.end())
+    return nullptr;
+  return &iter->second;
+}
+
+void Switch::forward(const ModuleID inWireID, Packet &&packet,
+                     const std::vector<int> *outPorts) {
   bool found = false;
-  packet.readData(0, mac.data(), 6);
-  uint64_t broad_int = NetworkUtil::arrayToUINT64(broadcast);
-  uint64_t mac_int = NetworkUtil::arrayToUINT64(mac);
-  for (const ModuleID wireID : this->ports) {
-    if (inWireID != wireID) {
-      if ((mac_int == broad_int) ||
-          ((this->mac_table.find(wireID) != this->mac_table.end()) &&
-           (this->mac_table[wireID].find(mac_int) !=
-            this->mac_table[wireID].end()))) {
-        found = true;
-        bool drop = false;
-        if (this->unreliable) {
-          Real val = this->dist.nextDistribution(0.0, 1.0);
-          if (this->drop_base < this->drop_base_limit)
-            this->drop_base = this->drop_base_final;
-          else
-            this->drop_base -= this->drop_base_diff;
-
-          if (val < this->drop_base)
-            drop = true;
+  if (outPorts == nullptr) {
+    // Broadcast is sent to every other port, dropped or not.
+    if (packet.getMetadata().destinationMAC == mac_broadcast) {
+      for (const ModuleID wireID : this->ports) {
+        if (inWireID != wireID) {
+          found = true;
+          transmit(wireID, packet.clone());
         }
-        Packet newPacket = packet.clone();
-        if (drop) {
-          if (newPacket.getSize() >= (14 + 20 + 20 + 4)) {
-            uint32_t data;
-            newPacket.readData(14 + 20 + 20, &data, sizeof(data));
-
-            if (data != 0xEEEEEEEE)
-              data = 0xEEEEEEEE;
-            else
-              data = 0xEEEEEEEF;
-
-            newPacket.writeData(14 + 20 + 20, &data, sizeof(data));
-          } else if (newPacket.getSize() >= (14 + 20 + 20)) {
-            uint16_t checksum;
-            newPacket.readData(14 + 20 + 16, &checksum, sizeof(checksum));
-
-            if (checksum != 0xEEEE)
-              checksum = 0xEEEE;
-            else
-              checksum = 0xEEEF;
-
-            newPacket.writeData(14 + 20 + 16, &checksum, sizeof(checksum));
-          }
-        }
-        this->sendPacket(wireID, std::move(newPacket));
+      }
+    }
+  } else {
+    for (int port : *outPorts) {
+      const ModuleID wireID = this->ports[port];
+      if (inWireID != wireID) {
+        found = true;
+        transmit(wireID, packet.clone());
       }
     }
   }
@@ -92,4 +75,60 @@ void Switch::packetArrived(const ModuleID inWireID, Packet &&packet) {
   }
 }
 
+void Switch::transmit(const ModuleID wireID, Packet &&newPacket) {
+  bool drop = false;
+  if (this->unreliable) {
+    Real val = this->dist.nextDistribution(0.0, 1.0);
+    if (this->drop_base < this->drop_base_limit)
+      this->drop_base = this->drop_base_final;
+    else
+      this->drop_base -= this->drop_base_diff;
+
+    if (val < this->drop_base)
+      drop = true;
+  }
+  if (drop) {
+    // Corrupt what the receiver would validate.
+    completeChecksums(newPacket);
+    if (newPacket.getSize() >= (14 + 20 + 20 + 4)) {
+      uint32_t data;
+      newPacket.readData(14 + 20 + 20, &data, sizeof(data));
+
+      if (data != 0xEEEEEEEE)
+        data = 0xEEEEEEEE;
+      else
+        data = 0xEEEEEEEF;
+
+      newPacket.writeData(14 + 20 + 20, &data, sizeof(data));
+    } else if (newPacket.getSize() >= (14 + 20 + 20)) {
+      uint16_t checksum;
+      newPacket.readData(14 + 20 + 16, &checksum, sizeof(checksum));
+
+      if (checksum != 0xEEEE)
+        checksum = 0xEEEE;
+      else
+        checksum = 0xEEEF;
+
+      newPacket.writeData(14 + 20 + 16, &checksum, sizeof(checksum));
+    }
+  }
+  this->sendPacket(wireID, std::move(newPacket));
+}
+
+void Switch::packetArrived(const ModuleID inWireID, Packet &&packet) {
+  parseEthernetHeader(packet);
+  const std::vector<int> *outPorts = lookup(packet);
+  forward(inWireID, std::move(packet), outPorts);
+}
+
+void Switch::packetsArrived(const ModuleID inWireID, PacketBatch &&batch) {
+  std::array<const std::vector<int> *, PacketBatch::CAPACITY> outPorts;
+  for (size_t k = 0; k < batch.size(); k++)
+    parseEthernetHeader(batch[k]);
+  for (size_t k = 0; k < batch.size(); k++)
+    outPorts[k] = lookup(batch[k]);
+  for (size_t k = 0; k < batch.size(); k++)
+    forward(inWireID, std::move(batch[k]), outPorts[k]);
+}
+
 } // namespace E
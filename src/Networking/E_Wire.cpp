@@ -11,6 +11,7 @@
 #include <E/Networking/E_Link.hpp>
 #include <E/Networking/E_Networking.hpp>
 #include <E/Networking/E_Packet.hpp>
+#include <E/Networking/E_PacketTracker.hpp>
 #include <E/Networking/E_Wire.hpp>
 
 namespace E {
@@ -36,33 +37,19 @@ Size Wire::getWireSpeed() { return this->bps; }
 
 void Wire::setPropagationDelay(Time delay) { propagationDelay = delay; }
 
-Module::Message Wire::messageReceived(const ModuleID from,
-                                      Module::MessageBase &message) {
-
-  Message &portMessage = dynamic_cast<Message &>(message);
-  assert(portMessage.type == Wire::PACKET_TO_PORT);
-
+Time Wire::transmit(int destination, const Packet &packet,
+                    const ModuleID from) {
   NetworkLog::print_log(
       NetworkLog::PACKET_FROM_MODULE,
       "Wire [%s] received a packet [size:%zu] from module [%s]",
-      this->getModuleName().c_str(), portMessage.packet.getSize(),
+      this->getModuleName().c_str(), packet.getSize(),
       this->getModuleName(from).c_str());
 
-  int destination = -1;
-  if (this->connected[0] == from)
-    destination = 1;
-  else if (this->connected[1] == from)
-    destination = 0;
-  if (destination == -1 || this->connected[destination] == 0) {
-    return nullptr;
-  }
-
   Time current_time = this->getCurrentTime();
   Time trans_delay = 0;
   if (this->bps != 0)
-    trans_delay =
-        (((Real)portMessage.packet.getSize() * 8 * (1000 * 1000 * 1000UL)) /
-         (Real)this->bps);
+    trans_delay = (((Real)packet.getSize() * 8 * (1000 * 1000 * 1000UL)) /
+                   (Real)this->bps);
   Time available_time = this->nextAvailable[destination];
   if (current_time > available_time) {
     available_time = current_time;
@@ -74,19 +61,80 @@ Module::Message Wire::messageReceived(const ModuleID from,
       NetworkLog::PACKET_TO_MODULE,
       "Wire [%s] send a packet [size:%zu] to module [%s] with transmission "
       "delay [%" PRIu64 "], propagation delay [%" PRIu64 "]",
-      this->getModuleName().c_str(), portMessage.packet.getSize(),
+      this->getModuleName().c_str(), packet.getSize(),
       this->getModuleName(connected[destination]).c_str(), trans_delay,
       propagationDelay);
 
-  auto fromWireMessage = std::make_unique<Message>(
-      MessageType::PACKET_FROM_PORT, std::move(portMessage.packet));
+  PACKET_TRACE(PacketTracker::stamp(packet, PacketTracker::WIRE_TRANSMIT, this,
+                                    current_time));
+  PACKET_TRACE(PacketTracker::stamp(
+      packet, PacketTracker::WIRE_TRANSMITTED, this,
+      this->limit_speed ? available_time : current_time));
 
   if (this->limit_speed)
-    sendMessage(this->connected[destination], std::move(fromWireMessage),
-                available_time + propagationDelay - current_time);
+    return available_time + propagationDelay - current_time;
   else
+    return propagationDelay;
+}
+
+void Wire::deliver(int destination, PacketBatch &&batch, Time delay) {
+  if (batch.size() == 1) {
+    auto fromWireMessage = std::make_unique<Message>(
+        MessageType::PACKET_FROM_PORT, std::move(batch[0]));
     sendMessage(this->connected[destination], std::move(fromWireMessage),
-                propagationDelay);
+                delay);
+  } else {
+    auto fromWireMessage = std::make_unique<BatchMessage>(
+        MessageType::PACKET_FROM_PORT, std::move(batch));
+    sendMessage(this->connected[destination], std::move(fromWireMessage),
+                delay);
+  }
+}
+
+Module::Message Wire::messageReceived(const ModuleID from,
+                                      Module::MessageBase &message) {
+  int destination = -1;
+  if (this->connected[0] == from)
+    destination = 1;
+  else if (this->connected[1] == from)
+    destination = 0;
+  if (destination == -1 || this->connected[destination] == 0) {
+    return nullptr;
+  }
+
+  if (typeid(message) == typeid(BatchMessage &)) {
+    BatchMessage &batchMessage = dynamic_cast<BatchMessage &>(message);
+    assert(batchMessage.type == Wire::PACKET_TO_PORT);
+
+    // Packets serialized back to back arrive at different times.
+    // Consecutive packets with the same delay stay in one batch.
+    PacketBatch &batch = batchMessage.batch;
+    Time current_time = this->getCurrentTime();
+    PacketBatch output;
+    Time output_delay = 0;
+    for (size_t k = 0; k < batch.size(); k++) {
+      Time delay = transmit(destination, batch[k], from);
+      if (!output.empty() && (delay != output_delay || output.full())) {
+        deliver(destination, std::move(output), output_delay);
+        output.clear();
+      }
+      if (output.empty())
+        output = PacketBatch(current_time + delay);
+      output_delay = delay;
+      output.push(std::move(batch[k]));
+    }
+    if (!output.empty())
+      deliver(destination, std::move(output), output_delay);
+    return nullptr;
+  }
+
+  Message &portMessage = dynamic_cast<Message &>(message);
+  assert(portMessage.type == Wire::PACKET_TO_PORT);
+
+  Time delay = transmit(destination, portMessage.packet, from);
+  auto fromWireMessage = std::make_unique<Message>(
+      MessageType::PACKET_FROM_PORT, std::move(portMessage.packet));
+  sendMessage(this->connected[destination], std::move(fromWireMessage), delay);
 
   return nullptr;
 }
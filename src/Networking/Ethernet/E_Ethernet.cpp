@@ -5,6 +5,7 @@
  *      Author: Keunhong Lee
  */
 
+#include <E/Networking/E_HeaderView.hpp>
 #include <E/Networking/E_Host.hpp>
 #include <E/Networking/E_Networking.hpp>
 #include <E/Networking/E_Packet.hpp>
@@ -19,34 +20,36 @@ static const std::set<ipv4_t> ip_broadcasts = {{
 }};
 
 Ethernet::Ethernet(Host &host)
-    : HostModule("Ethernet", host), RoutingInfoInterface(host) {}
+    : HostModule("Ethernet", host), RoutingInfoInterface(host),
+      ipv4Handle(getModuleHandle("IPv4")),
+      ipv6Handle(getModuleHandle("IPv6")) {}
 Ethernet::~Ethernet() {}
 void Ethernet::packetArrived(std::string fromModule, Packet &&packet) {
-  if (fromModule.compare("Host") == 0) {
-    uint8_t first_byte, second_byte;
-    packet.readData(12, &first_byte, 1);
-    packet.readData(13, &second_byte, 1);
+  packetArrived(getModuleHandle(fromModule), std::move(packet));
+}
+void Ethernet::packetArrived(ModuleHandle fromModule, Packet &&packet) {
+  if (fromModule == Host::HOST_HANDLE) {
+    parseEthernetHeader(packet);
+    uint16_t type = packet.getMetadata().etherType;
 
-    if (first_byte == 0x08 && second_byte == 0x00) {
-      this->sendPacket("IPv4", std::move(packet));
-    } else if (first_byte == 0x86 && second_byte == 0xDD) {
-      this->sendPacket("IPv6", std::move(packet));
+    if (type == EthernetHeaderView::ETHERTYPE_IPV4) {
+      this->sendPacket(ipv4Handle, std::move(packet));
+    } else if (type == EthernetHeaderView::ETHERTYPE_IPV6) {
+      this->sendPacket(ipv6Handle, std::move(packet));
     } else {
       this->print_log(NetworkLog::MODULE_ERROR, "Unsupported ethertype.");
       assert(0);
     }
-  } else if (fromModule.compare("IPv4") == 0) {
-    uint8_t first_byte = 0x08;
-    uint8_t second_byte = 0x00;
-    packet.writeData(12, &first_byte, 1);
-    packet.writeData(13, &second_byte, 1);
+  } else if (fromModule == ipv4Handle) {
+    EthernetHeaderView ethernet(packet);
+    ConstIPv4HeaderView ip(packet);
+    assert(ethernet && ip);
+    ethernet.setEtherType(EthernetHeaderView::ETHERTYPE_IPV4);
 
-    ipv4_t dst_ip;
-    packet.readData(30, dst_ip.data(), 4);
+    ipv4_t dst_ip = ip.getDestination();
     constexpr mac_t mac_broadcast = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
     if (ip_broadcasts.find(dst_ip) != ip_broadcasts.end()) {
-      ipv4_t src_ip;
-      packet.readData(26, src_ip.data(), 4);
+      ipv4_t src_ip = ip.getSource();
       int port = this->getRoutingTable(src_ip);
       auto src = this->getMACAddr(port);
 
@@ -56,8 +59,8 @@ void Ethernet::packetArrived(std::string fromModule, Packet &&packet) {
         return;
       }
 
-      packet.writeData(0, mac_broadcast.data(), 6);
-      packet.writeData(6, src.value().data(), 6);
+      ethernet.setDestination(mac_broadcast);
+      ethernet.setSource(src.value());
     } else {
       int port = this->getRoutingTable(dst_ip);
       auto src = this->getMACAddr(port);
@@ -76,16 +79,15 @@ void Ethernet::packetArrived(std::string fromModule, Packet &&packet) {
         return;
       }
 
-      packet.writeData(0, dst.value().data(), 6);
-      packet.writeData(6, src.value().data(), 6);
+      ethernet.setDestination(dst.value());
+      ethernet.setSource(src.value());
     }
-    this->sendPacket("Host", std::move(packet));
-  } else if (fromModule.compare("IPv6") == 0) {
-    uint8_t first_byte = 0x86;
-    uint8_t second_byte = 0xDD;
-    packet.writeData(12, &first_byte, 1);
-    packet.writeData(13, &second_byte, 1);
-    this->sendPacket("Host", std::move(packet));
+    this->sendPacket(Host::HOST_HANDLE, std::move(packet));
+  } else if (fromModule == ipv6Handle) {
+    EthernetHeaderView ethernet(packet);
+    assert(ethernet);
+    ethernet.setEtherType(EthernetHeaderView::ETHERTYPE_IPV6);
+    this->sendPacket(Host::HOST_HANDLE, std::move(packet));
   }
 }
 
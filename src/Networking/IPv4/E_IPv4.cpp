@@ -5,6 +5,7 @@
  *      Author: Keunhong Lee
  */
 
+#include <E/Networking/E_HeaderView.hpp>
 #include <E/Networking/E_Host.hpp>
 #include <E/Networking/E_NetworkUtil.hpp>
 #include <E/Networking/E_Networking.hpp>
@@ -15,23 +16,31 @@
 
 namespace E {
 
-IPv4::IPv4(Host &host) : HostModule("IPv4", host) { this->identification = 0; }
+IPv4::IPv4(Host &host)
+    : HostModule("IPv4", host), ethernetHandle(getModuleHandle("Ethernet")),
+      tcpHandle(getModuleHandle("TCP")), udpHandle(getModuleHandle("UDP")),
+      ospfHandle(getModuleHandle("OSPF")) {
+  this->identification = 0;
+}
 IPv4::~IPv4() {}
 
 void IPv4::packetArrived(std::string fromModule, Packet &&packet) {
-  if (fromModule.compare("Ethernet") == 0) {
-    {
-      char first_byte, second_byte;
-      packet.readData(12, &first_byte, 1);
-      packet.readData(13, &second_byte, 1);
+  packetArrived(getModuleHandle(fromModule), std::move(packet));
+}
 
-      assert(first_byte == 0x08 && second_byte == 0x00);
-    }
+void IPv4::packetArrived(ModuleHandle fromModule, Packet &&packet) {
+  if (fromModule == ethernetHandle || fromModule == Host::LOOPBACK_HANDLE) {
+    assert(ConstEthernetHeaderView(packet).getEtherType() ==
+           EthernetHeaderView::ETHERTYPE_IPV4);
 
-    size_t ip_start = 14;
-    uint8_t ip_header_buffer[20];
-    packet.readData(ip_start, ip_header_buffer, 20);
-    uint16_t checksum = NetworkUtil::one_sum(ip_header_buffer, 20);
+    ConstIPv4HeaderView ip(packet);
+    if (!ip) {
+      print_log(NetworkLog::PROTOCOL_ERROR, "Truncated IPv4 header.");
+      return;
+    }
+    uint16_t checksum = 0xFFFF;
+    if (!packet.getMetadata().has(PacketMetadata::IPV4_CHECKSUM))
+      checksum = NetworkUtil::one_sum(ip.getData(), ip.SIZE);
     if (checksum != 0xFFFF) {
       if (checksum != 0) {
         print_log(NetworkLog::PROTOCOL_ERROR, "Wrong checksum. Non-zero %u",
@@ -42,94 +51,87 @@ void IPv4::packetArrived(std::string fromModule, Packet &&packet) {
                 "Checksum should be negative zero %u", checksum);
     }
 
-    uint8_t protocol;
-    packet.readData(ip_start + 9, &protocol, 1);
+    uint8_t protocol = ip.getProtocol();
+    PacketMetadata &metadata = packet.getMetadata();
+    metadata.sourceIP = ip.getSource();
+    metadata.destinationIP = ip.getDestination();
+    metadata.protocol = protocol;
+    metadata.flags |= PacketMetadata::NETWORK_PARSED;
+    packet.setLayerOffset(Packet::NETWORK_LAYER, EthernetHeaderView::SIZE);
+
+    // TCP and UDP both start with the source and destination ports.
+    size_t l4_start = EthernetHeaderView::SIZE + ip.getHeaderLength() * 4;
+    if (protocol == 0x06 || protocol == 0x11) {
+      ConstUDPHeaderView ports(packet, l4_start);
+      if (ports) {
+        metadata.sourcePort = ports.getSourcePort();
+        metadata.destinationPort = ports.getDestinationPort();
+        metadata.flags |= PacketMetadata::TRANSPORT_PARSED;
+        packet.setLayerOffset(Packet::TRANSPORT_LAYER, l4_start);
+      }
+    }
+    metadata.flowHash = NetworkUtil::flow_hash(
+        metadata.sourceIP, metadata.destinationIP, protocol,
+        metadata.sourcePort, metadata.destinationPort);
+
     if (protocol == 0x06) // TCP
     {
-      this->sendPacket("TCP", std::move(packet));
+      this->sendPacket(tcpHandle, std::move(packet));
     } else if (protocol == 0x11) // UDP
     {
-      this->sendPacket("UDP", std::move(packet));
+      this->sendPacket(udpHandle, std::move(packet));
     } else if (protocol == 0x59) // OSPF
     {
-      this->sendPacket("OSPF", std::move(packet));
+      this->sendPacket(ospfHandle, std::move(packet));
     } else {
       // Not TCP/UDP
     }
-  } else if (fromModule.compare("TCP") == 0 || fromModule.compare("UDP") == 0 ||
-             fromModule.compare("OSPF") == 0) {
+  } else if (fromModule == tcpHandle || fromModule == udpHandle ||
+             fromModule == ospfHandle) {
     uint8_t proto = 0;
-    size_t ip_start = 14;
-    if (fromModule.compare("TCP") == 0) {
+    size_t ip_start = EthernetHeaderView::SIZE;
+    if (fromModule == tcpHandle) {
       proto = 0x06;
     }
-    if (fromModule.compare("UDP") == 0) {
+    if (fromModule == udpHandle) {
       proto = 0x11;
     }
-    if (fromModule.compare("OSPF") == 0) {
+    if (fromModule == ospfHandle) {
       proto = 0x59;
     }
-    uint8_t buf;
-
-    {
-      buf = 0;
-      buf += 4 << 4; // IPv4
-      buf += 5;      // hlen = 5
-      packet.writeData(ip_start + 0, &buf, 1);
-    }
-    {
-      buf = 0; // DSCP, ECN
-      packet.writeData(ip_start + 1, &buf, 1);
-    }
-    {
-      buf = 0;
-      assert(packet.getSize() >= ip_start + 20);
-      uint16_t size = packet.getSize() - ip_start;
-      buf = size >> 8;
-      packet.writeData(ip_start + 2, &buf, 1);
 
-      buf = (uint8_t)(size & 0xFF);
-      packet.writeData(ip_start + 3, &buf, 1);
-    }
-    {
-      uint16_t cur_id = identification++;
-      buf = 0;
-      buf = cur_id >> 8;
-      packet.writeData(ip_start + 4, &buf, 1);
+    assert(packet.getSize() >= ip_start + IPv4HeaderView::SIZE);
+    IPv4HeaderView ip(packet, ip_start);
+    assert(ip);
+    ip.setVersionAndHeaderLength(4, 5); // IPv4, hlen = 5
+    ip.setTypeOfService(0);             // DSCP, ECN
+    ip.setTotalLength(packet.getSize() - ip_start);
+    ip.setIdentification(identification++);
+    ip.setFragment(1 << 14); // Do not frag, offset = 0
+    ip.setTTL(64);
+    ip.setProtocol(proto);
+    ip.setChecksum(0);
+    // assume ip address is written
+    bool loopback = isLoopbackAddress(ip.getDestination());
 
-      buf = (uint8_t)(cur_id & 0xFF);
-      packet.writeData(ip_start + 5, &buf, 1);
-    }
-    {
-      buf = 1 << 6; // Do not frag
-      packet.writeData(ip_start + 6, &buf, 1);
-
-      buf = 0; // offset = 0;
-      packet.writeData(ip_start + 7, &buf, 1);
+    if (getChecksumOffload() || loopback) {
+      packet.getMetadata().offload |= PacketMetadata::IPV4_CHECKSUM;
+    } else {
+      uint16_t checksum = NetworkUtil::one_sum(ip.getData(), ip.SIZE);
+      ip.setChecksum(~checksum);
     }
-    {
-      buf = 64; // TTL
-      packet.writeData(ip_start + 8, &buf, 1);
 
-      buf = proto; // PROTOCOL
-      packet.writeData(ip_start + 9, &buf, 1);
-    }
-    {
-      buf = 0; // checksum
-      packet.writeData(ip_start + 10, &buf, 1);
-      packet.writeData(ip_start + 11, &buf, 1);
-    }
-    {
-      // assume ip address is written
+    if (loopback) {
+      // Ethernet is skipped, but receivers expect a complete frame. As on
+      // the loopback interface of Linux, both addresses are zero.
+      EthernetHeaderView ethernet(packet);
+      ethernet.setDestination(mac_t{});
+      ethernet.setSource(mac_t{});
+      ethernet.setEtherType(EthernetHeaderView::ETHERTYPE_IPV4);
+      this->sendPacket(Host::LOOPBACK_HANDLE, std::move(packet));
+    } else {
+      this->sendPacket(ethernetHandle, std::move(packet));
     }
-    uint8_t ip_header_buffer[20];
-    packet.readData(ip_start, ip_header_buffer, 20);
-    uint16_t checksum = NetworkUtil::one_sum(ip_header_buffer, 20);
-    checksum = ~checksum;
-    checksum = htons(checksum);
-    packet.writeData(ip_start + 10, (uint8_t *)&checksum, 2);
-
-    this->sendPacket("Ethernet", std::move(packet));
   } else {
     assert(0);
   }
@@ -8,6 +8,53 @@
 #include <E/Networking/TCP/E_TCPApplication.hpp>
 
 namespace E {
+
+// The return value is an int, so a call transfers at most INT_MAX bytes
+// (like MAX_RW_COUNT of Linux).
+static int clampCount(size_t count) {
+  return (int)std::min<size_t>(count, std::numeric_limits<int>::max());
+}
+
+static SystemCallInterface::SystemCallParameter
+readParameter(int fd, void *buf, size_t count) {
+  SystemCallInterface::SystemCallParameter param;
+  param.params[0] = fd;
+  param.params[1] = (void *)buf;
+  param.params[2] = clampCount(count);
+  param.syscallNumber = SystemCallInterface::SystemCall::READ;
+  return param;
+}
+
+static SystemCallInterface::SystemCallParameter
+writeParameter(int fd, const void *buf, size_t count) {
+  SystemCallInterface::SystemCallParameter param;
+  param.params[0] = fd;
+  param.params[1] = (void *)buf;
+  param.params[2] = clampCount(count);
+  param.syscallNumber = SystemCallInterface::SystemCall::WRITE;
+  return param;
+}
+
+static SystemCallInterface::SystemCallParameter
+connectParameter(int sockfd, const struct sockaddr *addr, socklen_t addrlen) {
+  SystemCallInterface::SystemCallParameter param;
+  param.params[0] = sockfd;
+  param.params[1] = (void *)addr;
+  param.params[2] = (int)addrlen;
+  param.syscallNumber = SystemCallInterface::SystemCall::CONNECT;
+  return param;
+}
+
+static SystemCallInterface::SystemCallParameter
+acceptParameter(int sockfd, struct sockaddr *addr, socklen_t *addrlen) {
+  SystemCallInterface::SystemCallParameter param;
+  param.params[0] = sockfd;
+  param.params[1] = (void *)addr;
+  param.params[2] = (void *)addrlen;
+  param.syscallNumber = SystemCallInterface::SystemCall::ACCEPT;
+  return param;
+}
+
 TCPApplication::TCPApplication(Host &host) : SystemCallApplication(host) {}
 TCPApplication::~TCPApplication() {}
 
@@ -18,6 +65,10 @@ int TCPApplication::socket(int domain, int type__unused, int protocol) {
   param.params[2] = protocol;
   param.syscallNumber = SystemCallInterface::SystemCall::SOCKET;
   int ret = E_Syscall(param);
+#ifdef SOCK_NONBLOCK
+  if (ret >= 0 && (type__unused & SOCK_NONBLOCK))
+    fcntl(ret, F_SETFL, O_NONBLOCK);
+#endif
   return ret;
 }
 int TCPApplication::close(int fd) {
@@ -58,32 +109,14 @@ int TCPApplication::getpeername(int sockfd, struct sockaddr *addr,
   return ret;
 }
 int TCPApplication::read(int fd, void *buf, size_t count) {
-  SystemCallInterface::SystemCallParameter param;
-  param.params[0] = fd;
-  param.params[1] = (void *)buf;
-  param.params[2] = (int)count;
-  param.syscallNumber = SystemCallInterface::SystemCall::READ;
-  int ret = E_Syscall(param);
-  return ret;
+  return E_Syscall(readParameter(fd, buf, count));
 }
 int TCPApplication::write(int fd, const void *buf, size_t count) {
-  SystemCallInterface::SystemCallParameter param;
-  param.params[0] = fd;
-  param.params[1] = (void *)buf;
-  param.params[2] = (int)count;
-  param.syscallNumber = SystemCallInterface::SystemCall::WRITE;
-  int ret = E_Syscall(param);
-  return ret;
+  return E_Syscall(writeParameter(fd, buf, count));
 }
 int TCPApplication::connect(int sockfd, const struct sockaddr *addr,
                             socklen_t addrlen) {
-  SystemCallInterface::SystemCallParameter param;
-  param.params[0] = sockfd;
-  param.params[1] = (void *)addr;
-  param.params[2] = (int)addrlen;
-  param.syscallNumber = SystemCallInterface::SystemCall::CONNECT;
-  int ret = E_Syscall(param);
-  return ret;
+  return E_Syscall(connectParameter(sockfd, addr, addrlen));
 }
 int TCPApplication::listen(int sockfd, int backlog) {
   SystemCallInterface::SystemCallParameter param;
@@ -95,13 +128,7 @@ int TCPApplication::listen(int sockfd, int backlog) {
 }
 int TCPApplication::accept(int sockfd, struct sockaddr *addr,
                            socklen_t *addrlen) {
-  SystemCallInterface::SystemCallParameter param;
-  param.params[0] = sockfd;
-  param.params[1] = (void *)addr;
-  param.params[2] = (void *)addrlen;
-  param.syscallNumber = SystemCallInterface::SystemCall::ACCEPT;
-  int ret = E_Syscall(param);
-  return ret;
+  return E_Syscall(acceptParameter(sockfd, addr, addrlen));
 }
 int TCPApplication::nsleep(uint64_t nanosleep) {
   SystemCallInterface::SystemCallParameter param;
@@ -130,4 +157,123 @@ int TCPApplication::gettimeofday(struct timeval *tv, struct timezone *tz) {
   return ret;
 }
 
+int TCPApplication::fcntl(int fd, int command, int argument) {
+  SystemCallInterface::SystemCallParameter param;
+  param.syscallNumber = SystemCallInterface::SystemCall::FCNTL;
+  param.params[0] = fd;
+  param.params[1] = command;
+  param.params[2] = argument;
+  int ret = E_Syscall(param);
+  return ret;
+}
+
+int TCPApplication::poll(struct pollfd *fds, nfds_t nfds, int timeout) {
+  SystemCallInterface::SystemCallParameter param;
+  param.syscallNumber = SystemCallInterface::SystemCall::POLL;
+  param.params[0] = (void *)fds;
+  param.params[1] = (uint64_t)nfds;
+  param.params[2] = timeout;
+  int ret = E_Syscall(param);
+  return ret;
+}
+
+int TCPApplication::epoll_create(int size__unused) {
+  SystemCallInterface::SystemCallParameter param;
+  param.syscallNumber = SystemCallInterface::SystemCall::EPOLL_CREATE;
+  param.params[0] = size__unused;
+  int ret = E_Syscall(param);
+  return ret;
+}
+
+int TCPApplication::epoll_ctl(int epfd, int operation, int fd,
+                              SystemCallInterface::EpollEvent *event) {
+  SystemCallInterface::SystemCallParameter param;
+  param.syscallNumber = SystemCallInterface::SystemCall::EPOLL_CTL;
+  param.params[0] = epfd;
+  param.params[1] = operation;
+  SystemCallInterface::SystemCallParameter::ExtraParameters extra = {
+      fd, (void *)event};
+  param.params[2] = (void *)&extra;
+  int ret = E_Syscall(param);
+  return ret;
+}
+
+int TCPApplication::epoll_wait(int epfd,
+                               SystemCallInterface::EpollEvent *events,
+                               int maxevents, int timeout) {
+  SystemCallInterface::SystemCallParameter param;
+  param.syscallNumber = SystemCallInterface::SystemCall::EPOLL_WAIT;
+  param.params[0] = epfd;
+  param.params[1] = (void *)events;
+  SystemCallInterface::SystemCallParameter::ExtraParameters extra = {
+      maxevents, timeout};
+  param.params[2] = (void *)&extra;
+  int ret = E_Syscall(param);
+  return ret;
+}
+
+int TCPApplication::readv(int fd, const struct iovec *iov, int iovcnt) {
+  SystemCallInterface::SystemCallParameter param;
+  param.syscallNumber = SystemCallInterface::SystemCall::READV;
+  param.params[0] = fd;
+  param.params[1] = (void *)iov;
+  param.params[2] = iovcnt;
+  int ret = E_Syscall(param);
+  return ret;
+}
+
+int TCPApplication::writev(int fd, const struct iovec *iov, int iovcnt) {
+  SystemCallInterface::SystemCallParameter param;
+  param.syscallNumber = SystemCallInterface::SystemCall::WRITEV;
+  param.params[0] = fd;
+  param.params[1] = (void *)iov;
+  param.params[2] = iovcnt;
+  int ret = E_Syscall(param);
+  return ret;
+}
+
+int TCPApplication::buffer_create(const void *data, size_t length) {
+  SystemCallInterface::SystemCallParameter param;
+  param.syscallNumber = SystemCallInterface::SystemCall::BUFFER_CREATE;
+  param.params[0] = (void *)data;
+  param.params[1] = (uint64_t)length;
+  int ret = E_Syscall(param);
+  return ret;
+}
+
+int TCPApplication::sendfile(int out_fd, int in_fd, off_t *offset,
+                             size_t count) {
+  SystemCallInterface::SystemCallParameter param;
+  param.syscallNumber = SystemCallInterface::SystemCall::SENDFILE;
+  param.params[0] = out_fd;
+  param.params[1] = in_fd;
+  SystemCallInterface::SystemCallParameter::ExtraParameters extra = {
+      (uint64_t)(offset ? *offset : 0), clampCount(count)};
+  param.params[2] = (void *)&extra;
+  int ret = E_Syscall(param);
+  if (ret > 0 && offset != nullptr)
+    *offset += ret;
+  return ret;
+}
+
+void TCPApplication::prepareRead(int fd, void *buf, size_t count,
+                                 uint64_t userData) {
+  E_SyscallPrepare(readParameter(fd, buf, count), userData);
+}
+
+void TCPApplication::prepareWrite(int fd, const void *buf, size_t count,
+                                  uint64_t userData) {
+  E_SyscallPrepare(writeParameter(fd, buf, count), userData);
+}
+
+void TCPApplication::prepareConnect(int sockfd, const struct sockaddr *addr,
+                                    socklen_t addrlen, uint64_t userData) {
+  E_SyscallPrepare(connectParameter(sockfd, addr, addrlen), userData);
+}
+
+void TCPApplication::prepareAccept(int sockfd, struct sockaddr *addr,
+                                   socklen_t *addrlen, uint64_t userData) {
+  E_SyscallPrepare(acceptParameter(sockfd, addr, addrlen), userData);
+}
+
 } // namespace E